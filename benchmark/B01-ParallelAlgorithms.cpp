@@ -0,0 +1,100 @@
+/***************************
+@File: B01-ParallelAlgorithms.cpp
+@Desc: UParallelAlgorithms 与串行STL的耗时对比，每项取多次运行中的最小值，并校验结果一致
+       编译：g++ -std=c++17 -O2 -pthread benchmark/B01-ParallelAlgorithms.cpp src/UThreadPool.cpp -o B01
+       运行：./B01 [元素个数，默认为10000000]
+***************************/
+
+#include <iostream>
+#include <iomanip>
+#include <numeric>
+#include <random>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstdlib>
+
+#include "../src/Algorithm/UParallelAlgorithms.hpp"
+
+static const int BENCH_ROUND = 5;
+
+/**
+ * 执行多次，返回最小耗时，单位为ms。prepare 不计入耗时
+ */
+template<typename PrepareFunc, typename RunFunc>
+static double measure(const PrepareFunc& prepare, const RunFunc& run) {
+    double best = 0;
+    for (int i = 0; i < BENCH_ROUND; i++) {
+        prepare();
+        auto start = std::chrono::steady_clock::now();
+        run();
+        double cost = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best = (0 == i || cost < best) ? cost : best;
+    }
+    return best;
+}
+
+
+static void report(const std::string& name, double serial, double parallel, bool same) {
+    std::cout << std::left << std::setw(16) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(12) << serial << " ms" << std::setw(12) << parallel << " ms"
+              << std::setw(10) << serial / parallel << "x" << (same ? "" : "    [MISMATCH]") << std::endl;
+}
+
+
+int main(int argc, char** argv) {
+    CSize size = (argc > 1) ? (CSize)std::strtoull(argv[1], nullptr, 10) : 10000000;
+    std::mt19937_64 engine(42);
+    std::vector<long> origin(size);
+    for (auto& cur : origin) {
+        cur = (long)(engine() % 1000000);
+    }
+
+    UThreadPool pool;
+    std::vector<long> a, b;
+    std::vector<long> outA(size), outB(size);
+    std::cout << "elements: " << size << ", threads: " << std::thread::hardware_concurrency() << std::endl;
+    std::cout << std::left << std::setw(16) << "algorithm" << std::right
+              << std::setw(15) << "serial STL" << std::setw(15) << "parallel" << std::setw(11) << "speedup" << std::endl;
+
+    auto resetA = [&] { a = origin; };
+    auto resetB = [&] { b = origin; };
+
+    double serial = measure(resetA, [&] { std::sort(a.begin(), a.end()); });
+    double parallel = measure(resetB, [&] { UParallelAlgorithms::sort(&pool, b.begin(), b.end()); });
+    report("sort", serial, parallel, a == b);
+
+    resetA();
+    resetB();
+    serial = measure([] {}, [&] { std::inclusive_scan(a.begin(), a.end(), outA.begin()); });
+    parallel = measure([] {}, [&] { UParallelAlgorithms::inclusiveScan(&pool, b.begin(), b.end(), outB.begin()); });
+    report("inclusive_scan", serial, parallel, outA == outB);
+
+    serial = measure([] {}, [&] { std::exclusive_scan(a.begin(), a.end(), outA.begin(), 0L); });
+    parallel = measure([] {}, [&] { UParallelAlgorithms::exclusiveScan(&pool, b.begin(), b.end(), outB.begin(), 0L); });
+    report("exclusive_scan", serial, parallel, outA == outB);
+
+    auto op = [](long x) { return x * 3 + (x >> 2); };
+    serial = measure([] {}, [&] { std::transform(a.begin(), a.end(), outA.begin(), op); });
+    parallel = measure([] {}, [&] { UParallelAlgorithms::transform(&pool, b.begin(), b.end(), outB.begin(), op); });
+    report("transform", serial, parallel, outA == outB);
+
+    auto pred = [](long x) { return 0 == (x & 1); };
+    CSize sizeA = 0, sizeB = 0;
+    serial = measure([] {}, [&] { sizeA = std::copy_if(a.begin(), a.end(), outA.begin(), pred) - outA.begin(); });
+    parallel = measure([] {}, [&] { sizeB = UParallelAlgorithms::copyIf(&pool, b.begin(), b.end(), outB.begin(), pred) - outB.begin(); });
+    report("copy_if", serial, parallel, sizeA == sizeB && std::equal(outA.begin(), outA.begin() + sizeA, outB.begin()));
+
+    // 并行版本保持相对顺序，与 stable_partition 对比
+    serial = measure(resetA, [&] { sizeA = std::stable_partition(a.begin(), a.end(), pred) - a.begin(); });
+    parallel = measure(resetB, [&] { sizeB = UParallelAlgorithms::partition(&pool, b.begin(), b.end(), pred) - b.begin(); });
+    report("partition", serial, parallel, sizeA == sizeB && a == b);
+
+    std::vector<long> sorted = origin;
+    std::sort(sorted.begin(), sorted.end());
+    serial = measure([&] { a = sorted; }, [&] { sizeA = std::unique(a.begin(), a.end()) - a.begin(); });
+    parallel = measure([&] { b = sorted; }, [&] { sizeB = UParallelAlgorithms::unique(&pool, b.begin(), b.end()) - b.begin(); });
+    report("unique", serial, parallel, sizeA == sizeB && std::equal(a.begin(), a.begin() + sizeA, b.begin()));
+
+    return 0;
+}
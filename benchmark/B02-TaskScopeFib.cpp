@@ -0,0 +1,98 @@
+/***************************
+@File: B02-TaskScopeFib.cpp
+@Desc: UTaskScope 的fork-join开销，以递归fib为例，与串行版本对比
+       cutoff 以下的子问题串行计算；cutoff为0时每次递归都spawn，可以看出单次spawn的开销
+       同时给出单个子任务实体的申请释放耗时，用于评估子任务的内存开销
+       编译：g++ -std=c++17 -O2 -pthread benchmark/B02-TaskScopeFib.cpp src/UThreadPool.cpp -o B02
+       运行：./B02 [n，默认为35]
+***************************/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+#include "../src/UThreadPool.hpp"
+
+static long fibSerial(int n) {
+    return n < 2 ? n : fibSerial(n - 1) + fibSerial(n - 2);
+}
+
+
+static long fibScope(UThreadPool* pool, int n, int cutoff) {
+    if (n < 2) {
+        return n;
+    }
+    if (n <= cutoff) {
+        return fibSerial(n);
+    }
+
+    long x = 0;
+    UTaskScope scope(pool);
+    scope.spawn([pool, n, cutoff, &x] { x = fibScope(pool, n - 1, cutoff); });
+    long y = fibScope(pool, n - 2, cutoff);
+    scope.sync();
+    return x + y;
+}
+
+
+static long spawnCount(int n, int cutoff) {
+    return (n < 2 || n <= cutoff) ? 0 : 1 + spawnCount(n - 1, cutoff) + spawnCount(n - 2, cutoff);
+}
+
+
+static const int BENCH_ROUND = 3;
+
+/**
+ * 执行多次，返回最小耗时，单位为ms
+ */
+template<typename Func>
+static double measure(const Func& func) {
+    double best = 0;
+    for (int i = 0; i < BENCH_ROUND; i++) {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        double cost = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best = (0 == i || cost < best) ? cost : best;
+    }
+    return best;
+}
+
+
+int main(int argc, char** argv) {
+    int n = (argc > 1) ? std::atoi(argv[1]) : 35;
+    UThreadPool pool;
+
+    long expect = 0;
+    double serial = measure([&] { expect = fibSerial(n); });
+    std::cout << "fib(" << n << ") = " << expect << ", threads: " << pool.getPrimarySize() << std::endl;
+    std::cout << std::left << std::setw(10) << "cutoff" << std::right << std::setw(12) << "spawns"
+              << std::setw(14) << "time" << std::setw(14) << "vs serial" << std::setw(16) << "ns / spawn" << std::endl;
+    std::cout << std::left << std::setw(10) << "serial" << std::right << std::setw(12) << 0
+              << std::fixed << std::setprecision(2) << std::setw(11) << serial << " ms" << std::setw(13) << 1.0 << "x" << std::endl;
+
+    for (int cutoff : {0, 5, 10, 15, 20}) {
+        long result = 0;
+        double cost = measure([&] {
+            result = pool.commit([&] { return fibScope(&pool, n, cutoff); }).get();
+        });
+        long spawns = spawnCount(n, cutoff);
+        std::cout << std::left << std::setw(10) << cutoff << std::right << std::setw(12) << spawns
+                  << std::setw(11) << cost << " ms" << std::setw(13) << cost / serial << "x"
+                  << std::setw(16) << (spawns > 0 ? (cost - serial) * 1e6 / (double)spawns : 0.0)
+                  << (result == expect ? "" : "    [MISMATCH]") << std::endl;
+    }
+
+    // 子任务实体的申请和释放（与spawn中的闭包大小相同），单独计时
+    const long times = 5000000;
+    long sink = 0;
+    double alloc = measure([&] {
+        for (long i = 0; i < times; i++) {
+            long* x = &sink;
+            UTask task([&pool, i, x] { *x += i + (long)pool.getPrimarySize(); });
+            (void)task;
+        }
+    });
+    std::cout << "task entity malloc + free: " << alloc * 1e6 / (double)times << " ns" << std::endl;
+    return 0;
+}
@@ -0,0 +1,80 @@
+/***************************
+@File: B03-StartupLatency.cpp
+@Desc: 线程池的启动和销毁耗时，适用于命令行工具等短生命周期的场景
+       启动耗时：从构造线程池，到第一个任务执行完成并拿到结果
+       销毁耗时：析构线程池，包含停止监控线程和所有工作线程
+       分别对比默认配置、延迟创建主线程（lazy_primary_enable_）和关闭监控线程（monitor_enable_）
+       编译：g++ -std=c++17 -O2 -pthread benchmark/B03-StartupLatency.cpp src/UThreadPool.cpp -o B03
+       运行：./B03 [主线程个数，默认为 DEFAULT_THREAD_SIZE]
+***************************/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <optional>
+#include <cstdlib>
+
+#include "../src/UThreadPool.hpp"
+
+static const int BENCH_ROUND = 20;
+
+static double elapsed(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+/**
+ * 多次创建并销毁线程池，输出启动和销毁耗时的最小值和平均值，单位为us
+ */
+static void measure(const std::string& name, const UThreadPoolConfig& config) {
+    double startBest = 0, startSum = 0, stopBest = 0, stopSum = 0;
+    std::optional<UThreadPool> pool;
+    for (int i = 0; i < BENCH_ROUND; i++) {
+        auto start = std::chrono::steady_clock::now();
+        pool.emplace(true, config);
+        pool->commit([] {}).get();
+        double startCost = elapsed(start);
+
+        start = std::chrono::steady_clock::now();
+        pool.reset();
+        double stopCost = elapsed(start);
+
+        startBest = (0 == i || startCost < startBest) ? startCost : startBest;
+        stopBest = (0 == i || stopCost < stopBest) ? stopCost : stopBest;
+        startSum += startCost;
+        stopSum += stopCost;
+    }
+
+    std::cout << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(12) << startBest << std::setw(12) << startSum / BENCH_ROUND
+              << std::setw(12) << stopBest << std::setw(12) << stopSum / BENCH_ROUND << std::endl;
+}
+
+
+int main(int argc, char** argv) {
+    UThreadPoolConfig config;
+    if (argc > 1) {
+        config.default_thread_size_ = std::atoi(argv[1]);
+        config.max_thread_size_ = std::max(config.max_thread_size_, config.default_thread_size_);
+    }
+
+    std::cout << "primary threads: " << config.default_thread_size_ << ", rounds: " << BENCH_ROUND << ", unit: us" << std::endl;
+    std::cout << std::left << std::setw(20) << "config" << std::right << std::setw(12) << "start best"
+              << std::setw(12) << "start avg" << std::setw(12) << "stop best" << std::setw(12) << "stop avg" << std::endl;
+
+    measure("default", config);
+
+    UThreadPoolConfig lazy = config;
+    lazy.lazy_primary_enable_ = true;
+    measure("lazy primary", lazy);
+
+    UThreadPoolConfig noMonitor = config;
+    noMonitor.monitor_enable_ = false;
+    measure("no monitor", noMonitor);
+
+    UThreadPoolConfig both = lazy;
+    both.monitor_enable_ = false;
+    measure("lazy + no monitor", both);
+    return 0;
+}
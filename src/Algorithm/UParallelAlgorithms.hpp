@@ -0,0 +1,492 @@
+/***************************
+@File: UParallelAlgorithms.h
+@Desc: 基于线程池的并行算法，包括排序、前缀和、变换、筛选、划分和去重
+       数据按块切分，线程通过原子下标领取数据块，调用线程同样参与计算
+       迭代器需要支持随机访问
+***************************/
+
+#ifndef UPARALLELALGORITHMS_H
+#define UPARALLELALGORITHMS_H
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <exception>
+
+#include "../ThreadPoolinc.hpp"
+#include "../UThreadPool.hpp"
+
+class UParallelAlgorithms {
+    static const CSize MIN_CHUNK_BYTES = 16 * 1024;              // 数据块的最小字节数，保证块内数据可以放入L1缓存
+    static const CSize CHUNK_PER_THREAD = 4;                     // 每个线程平均分到的数据块个数，用于负载均衡
+
+    /**
+     * 一次并行计算的共享状态，由调用线程和辅助任务共同持有
+     */
+    struct UParallelState {
+        std::atomic<CSize> next_ { 0 };                          // 下一个待领取的数据块
+        std::atomic<CSize> finished_ { 0 };                      // 已完成的数据块个数
+        CSize size_ = 0;                                         // 数据块总数
+        const std::function<CVoid(CSize)>* func_ = nullptr;      // 仅在领取到数据块时访问，此时调用线程一定在等待
+        std::mutex exception_mutex_;
+        std::exception_ptr exception_ = nullptr;                 // 记录第一个异常，由调用线程重新抛出
+    };
+
+public:
+    /**
+     * 并行归并排序。各数据块先分别排序，再逐轮两两归并，区间宽度翻倍
+     * 每轮归并按照输出位置切分成与数据块等长的片段，通过二分查找确定每个片段在两个输入区间中的起止位置，
+     * 因此每一轮（包括最后一轮）都可以由所有线程并行完成
+     * @param pool 为空时串行执行
+     * @param first
+     * @param last
+     * @param comp
+     * @notice 需要额外的缓存，元素类型需要支持默认构造
+     */
+    template<typename RandomIt, typename Compare = std::less<typename std::iterator_traits<RandomIt>::value_type>>
+    static CVoid sort(UThreadPoolPtr pool, RandomIt first, RandomIt last, Compare comp = Compare()) {
+        using ValueType = typename std::iterator_traits<RandomIt>::value_type;
+        CSize size = std::distance(first, last);
+        CSize chunkSize = calcChunkSize<ValueType>(pool, size);
+        CSize chunkNum = (size + chunkSize - 1) / chunkSize;
+        if (chunkNum <= 1) {
+            std::sort(first, last, comp);
+            return;
+        }
+
+        parallel(pool, chunkNum, [&](CSize index) {
+            std::sort(first + std::min(index * chunkSize, size),
+                      first + std::min((index + 1) * chunkSize, size), comp);
+        });
+
+        // 在原区间和缓存之间交替归并
+        std::vector<ValueType> buffer(size);
+        CBool inBuffer = false;
+        for (CSize width = 1; width < chunkNum; width *= 2) {
+            if (inBuffer) {
+                mergeRound(pool, buffer.begin(), first, size, chunkSize, chunkNum, width, comp);
+            } else {
+                mergeRound(pool, first, buffer.begin(), size, chunkSize, chunkNum, width, comp);
+            }
+            inBuffer = !inBuffer;
+        }
+
+        if (inBuffer) {
+            moveBack(pool, buffer, first, size);
+        }
+    }
+
+    /**
+     * 并行变换，d_first[i] = op(first[i])
+     * @param pool
+     * @param first
+     * @param last
+     * @param dFirst 可以与first相同
+     * @param op
+     * @return 输出的结尾
+     */
+    template<typename InputIt, typename OutputIt, typename UnaryOp>
+    static OutputIt transform(UThreadPoolPtr pool, InputIt first, InputIt last, OutputIt dFirst, UnaryOp op) {
+        CSize size = std::distance(first, last);
+        CSize chunkSize = calcChunkSize<typename std::iterator_traits<InputIt>::value_type>(pool, size);
+        parallel(pool, (size + chunkSize - 1) / chunkSize, [&](CSize index) {
+            CSize begin = index * chunkSize;
+            CSize end = std::min(begin + chunkSize, size);
+            for (CSize i = begin; i < end; i++) {
+                dFirst[i] = op(first[i]);    // 下标形式的简单循环，便于编译器向量化
+            }
+        });
+        return dFirst + size;
+    }
+
+    /**
+     * 并行包含扫描，d_first[i] = first[0] op ... op first[i]
+     * @param pool
+     * @param first
+     * @param last
+     * @param dFirst 可以与first相同
+     * @param op 需要满足结合律
+     * @return 输出的结尾
+     */
+    template<typename InputIt, typename OutputIt,
+             typename BinaryOp = std::plus<typename std::iterator_traits<InputIt>::value_type>>
+    static OutputIt inclusiveScan(UThreadPoolPtr pool, InputIt first, InputIt last, OutputIt dFirst,
+                                  BinaryOp op = BinaryOp()) {
+        using ValueType = typename std::iterator_traits<InputIt>::value_type;
+        CSize size = std::distance(first, last);
+        CSize chunkSize = calcChunkSize<ValueType>(pool, size);
+        CSize chunkNum = (size + chunkSize - 1) / chunkSize;
+        if (0 == size) {
+            return dFirst;
+        }
+
+        // 先计算每个数据块的和，再串行得到每个块的初始值，最后各块独立扫描
+        std::vector<ValueType> sums(chunkNum);
+        parallel(pool, chunkNum, [&](CSize index) {
+            CSize begin = index * chunkSize;
+            CSize end = std::min(begin + chunkSize, size);
+            ValueType sum = first[begin];
+            for (CSize i = begin + 1; i < end; i++) {
+                sum = op(sum, first[i]);
+            }
+            sums[index] = sum;
+        });
+        for (CSize i = 1; i < chunkNum; i++) {
+            sums[i] = op(sums[i - 1], sums[i]);
+        }
+
+        parallel(pool, chunkNum, [&](CSize index) {
+            CSize begin = index * chunkSize;
+            CSize end = std::min(begin + chunkSize, size);
+            ValueType carry = (0 == index) ? first[begin] : op(sums[index - 1], first[begin]);
+            dFirst[begin] = carry;
+            for (CSize i = begin + 1; i < end; i++) {
+                carry = op(carry, first[i]);
+                dFirst[i] = carry;
+            }
+        });
+        return dFirst + size;
+    }
+
+    /**
+     * 并行不包含扫描，d_first[0] = init，d_first[i] = init op first[0] op ... op first[i-1]
+     * @param pool
+     * @param first
+     * @param last
+     * @param dFirst 可以与first相同
+     * @param init
+     * @param op 需要满足结合律
+     * @return 输出的结尾
+     */
+    template<typename InputIt, typename OutputIt, typename T, typename BinaryOp = std::plus<T>>
+    static OutputIt exclusiveScan(UThreadPoolPtr pool, InputIt first, InputIt last, OutputIt dFirst,
+                                  T init, BinaryOp op = BinaryOp()) {
+        CSize size = std::distance(first, last);
+        CSize chunkSize = calcChunkSize<T>(pool, size);
+        CSize chunkNum = (size + chunkSize - 1) / chunkSize;
+        if (0 == size) {
+            return dFirst;
+        }
+
+        // sums[i] 为第i个数据块的初始值
+        std::vector<T> sums(chunkNum + 1, init);
+        parallel(pool, chunkNum, [&](CSize index) {
+            CSize begin = index * chunkSize;
+            CSize end = std::min(begin + chunkSize, size);
+            T sum = first[begin];
+            for (CSize i = begin + 1; i < end; i++) {
+                sum = op(sum, first[i]);
+            }
+            sums[index + 1] = sum;
+        });
+        for (CSize i = 1; i <= chunkNum; i++) {
+            sums[i] = op(sums[i - 1], sums[i]);
+        }
+
+        parallel(pool, chunkNum, [&](CSize index) {
+            CSize begin = index * chunkSize;
+            CSize end = std::min(begin + chunkSize, size);
+            T carry = sums[index];
+            for (CSize i = begin; i < end; i++) {
+                T value = first[i];    // 先读后写，支持原地扫描
+                dFirst[i] = carry;
+                carry = op(carry, value);
+            }
+        });
+        return dFirst + size;
+    }
+
+    /**
+     * 并行筛选，保持原有顺序
+     * @param pool
+     * @param first
+     * @param last
+     * @param dFirst 不能与输入区间重叠
+     * @param pred
+     * @return 输出的结尾
+     */
+    template<typename InputIt, typename OutputIt, typename UnaryPred>
+    static OutputIt copyIf(UThreadPoolPtr pool, InputIt first, InputIt last, OutputIt dFirst, UnaryPred pred) {
+        CSize total = compact<typename std::iterator_traits<InputIt>::value_type>(
+            pool, std::distance(first, last),
+            [&](CSize i) { return (CBool)pred(first[i]); },
+            [&](CSize i, CBool flag, CSize pos, CSize) {
+                if (flag) {
+                    dFirst[pos] = first[i];
+                }
+            });
+        return dFirst + total;
+    }
+
+    /**
+     * 并行划分，满足条件的元素写入dTrue，其余写入dFalse，均保持原有顺序
+     * @param pool
+     * @param first
+     * @param last
+     * @param dTrue
+     * @param dFalse
+     * @param pred
+     * @return 两个输出的结尾
+     */
+    template<typename InputIt, typename OutputIt1, typename OutputIt2, typename UnaryPred>
+    static std::pair<OutputIt1, OutputIt2> partitionCopy(UThreadPoolPtr pool, InputIt first, InputIt last,
+                                                         OutputIt1 dTrue, OutputIt2 dFalse, UnaryPred pred) {
+        CSize size = std::distance(first, last);
+        CSize total = compact<typename std::iterator_traits<InputIt>::value_type>(
+            pool, size,
+            [&](CSize i) { return (CBool)pred(first[i]); },
+            [&](CSize i, CBool flag, CSize pos, CSize) {
+                if (flag) {
+                    dTrue[pos] = first[i];
+                } else {
+                    dFalse[i - pos] = first[i];
+                }
+            });
+        return { dTrue + total, dFalse + (size - total) };
+    }
+
+    /**
+     * 并行稳定划分，原地进行
+     * @param pool
+     * @param first
+     * @param last
+     * @param pred
+     * @return 第一个不满足条件的元素
+     * @notice 需要额外的缓存，元素类型需要支持默认构造
+     */
+    template<typename RandomIt, typename UnaryPred>
+    static RandomIt partition(UThreadPoolPtr pool, RandomIt first, RandomIt last, UnaryPred pred) {
+        using ValueType = typename std::iterator_traits<RandomIt>::value_type;
+        CSize size = std::distance(first, last);
+        std::vector<ValueType> buffer(size);
+        CSize total = compact<ValueType>(
+            pool, size,
+            [&](CSize i) { return (CBool)pred(first[i]); },
+            [&](CSize i, CBool flag, CSize pos, CSize trueNum) {
+                buffer[flag ? pos : trueNum + i - pos] = std::move(first[i]);
+            });
+        moveBack(pool, buffer, first, size);
+        return first + total;
+    }
+
+    /**
+     * 并行去重，相邻的相等元素仅保留第一个，原地进行
+     * @param pool
+     * @param first
+     * @param last
+     * @param pred 判断两个元素是否相等
+     * @return 去重后的结尾
+     * @notice 需要额外的缓存，元素类型需要支持默认构造
+     */
+    template<typename RandomIt,
+             typename BinaryPred = std::equal_to<typename std::iterator_traits<RandomIt>::value_type>>
+    static RandomIt unique(UThreadPoolPtr pool, RandomIt first, RandomIt last, BinaryPred pred = BinaryPred()) {
+        using ValueType = typename std::iterator_traits<RandomIt>::value_type;
+        CSize size = std::distance(first, last);
+        std::vector<ValueType> buffer(size);
+        CSize total = compact<ValueType>(
+            pool, size,
+            [&](CSize i) { return 0 == i || !pred(first[i - 1], first[i]); },
+            [&](CSize i, CBool flag, CSize pos, CSize) {
+                if (flag) {
+                    buffer[pos] = std::move(first[i]);    // 标记在此之前已全部计算完成，可以移动
+                }
+            });
+        moveBack(pool, buffer, first, total);
+        return first + total;
+    }
+
+protected:
+    /**
+     * 计算数据块的大小。不小于缓存块的大小，且保证每个线程能分到多个数据块
+     * @tparam T
+     * @param pool
+     * @param size
+     * @return
+     */
+    template<typename T>
+    static CSize calcChunkSize(UThreadPoolPtr pool, CSize size) {
+        CSize threadSize = (nullptr == pool) ? 1 : (CSize)std::max(pool->getPrimarySize(), 1);
+        CSize minSize = std::max<CSize>(MIN_CHUNK_BYTES / sizeof(T), 1);
+        return std::max(minSize, size / (threadSize * CHUNK_PER_THREAD));
+    }
+
+    /**
+     * 并行执行 func(0) ~ func(size-1)，调用线程参与计算，全部完成后返回
+     * 在线程池的任务中调用也不会死锁，最坏情况下由调用线程完成所有计算
+     * 所有数据块被领取后，调用线程通过让出cpu自旋等待其他线程完成最后的数据块，
+     * 等待时间不超过一个数据块的计算时间，因此没有使用条件变量
+     * @param pool
+     * @param size
+     * @param func
+     */
+    static CVoid parallel(UThreadPoolPtr pool, CSize size, const std::function<CVoid(CSize)>& func) {
+        if (nullptr == pool || size <= 1) {
+            for (CSize i = 0; i < size; i++) {
+                func(i);
+            }
+            return;
+        }
+
+        auto state = std::make_shared<UParallelState>();
+        state->size_ = size;
+        state->func_ = &func;
+        CSize helperSize = std::min<CSize>(size - 1, std::max(pool->getPrimarySize(), 1));
+        for (CSize i = 0; i < helperSize; i++) {
+            pool->commit([state] { work(*state); });
+        }
+
+        work(*state);
+        while (state->finished_.load(std::memory_order_acquire) < size) {
+            std::this_thread::yield();    // 剩余的数据块正在被其他线程计算
+        }
+
+        if (state->exception_) {
+            std::rethrow_exception(state->exception_);
+        }
+    }
+
+    /**
+     * 领取并计算数据块，直到全部被领取
+     * @param state
+     */
+    static CVoid work(UParallelState& state) {
+        CSize index = 0;
+        while ((index = state.next_.fetch_add(1, std::memory_order_relaxed)) < state.size_) {
+            try {
+                (*state.func_)(index);
+            } catch (...) {
+                LOCK_GUARD lk(state.exception_mutex_);
+                if (!state.exception_) {
+                    state.exception_ = std::current_exception();
+                }
+            }
+            state.finished_.fetch_add(1, std::memory_order_acq_rel);
+        }
+    }
+
+    /**
+     * 一轮归并：src中宽度为width个数据块的有序区间，两两归并后写入dst
+     * 输出按照数据块切分，第k块的数据来自同一对区间，分别计算其起止位置在两个区间中的划分后独立归并
+     * @param pool
+     * @param src
+     * @param dst
+     * @param size 元素总数
+     * @param chunkSize
+     * @param chunkNum
+     * @param width 当前有序区间包含的数据块个数
+     * @param comp
+     */
+    template<typename SrcIt, typename DstIt, typename Compare>
+    static CVoid mergeRound(UThreadPoolPtr pool, SrcIt src, DstIt dst, CSize size,
+                           CSize chunkSize, CSize chunkNum, CSize width, Compare& comp) {
+        parallel(pool, chunkNum, [&](CSize index) {
+            CSize pairBegin = std::min(index / (2 * width) * 2 * width * chunkSize, size);
+            CSize pairMid = std::min(pairBegin + width * chunkSize, size);
+            CSize pairEnd = std::min(pairMid + width * chunkSize, size);
+            SrcIt left = src + pairBegin;
+            SrcIt right = src + pairMid;
+            CSize leftSize = pairMid - pairBegin;
+            CSize rightSize = pairEnd - pairMid;
+
+            CSize outBegin = std::min(index * chunkSize, size) - pairBegin;
+            CSize outEnd = std::min((index + 1) * chunkSize, size) - pairBegin;
+            CSize leftBegin = coRank(outBegin, left, leftSize, right, rightSize, comp);
+            CSize leftEnd = coRank(outEnd, left, leftSize, right, rightSize, comp);
+            std::merge(std::make_move_iterator(left + leftBegin), std::make_move_iterator(left + leftEnd),
+                       std::make_move_iterator(right + (outBegin - leftBegin)),
+                       std::make_move_iterator(right + (outEnd - leftEnd)),
+                       dst + (pairBegin + outBegin), comp);
+        });
+    }
+
+    /**
+     * 计算两个有序区间稳定归并后，前pos个元素中来自left的个数（相等时left在前，与 std::merge 一致）
+     * @param pos
+     * @param left
+     * @param leftSize
+     * @param right
+     * @param rightSize
+     * @param comp
+     * @return
+     */
+    template<typename It, typename Compare>
+    static CSize coRank(CSize pos, It left, CSize leftSize, It right, CSize rightSize, Compare& comp) {
+        CSize low = pos > rightSize ? pos - rightSize : 0;
+        CSize high = std::min(pos, leftSize);
+        // 查找最小的i，使得 right[pos-i-1] < left[i]，即 left[i] 排在输出的第pos个位置之后
+        while (low < high) {
+            CSize mid = low + (high - low) / 2;
+            if (comp(right[pos - mid - 1], left[mid])) {
+                high = mid;
+            } else {
+                low = mid + 1;
+            }
+        }
+        return low;
+    }
+
+    /**
+     * 筛选类算法的公共流程：逐块计算标记和个数，串行计算每块的起始位置，再逐块输出
+     * @param pool
+     * @param size
+     * @param keep 计算第i个元素的标记
+     * @param visit 参数为下标、标记、在此之前标记为true的个数、标记为true的总数
+     * @return 标记为true的总数
+     */
+    template<typename T, typename KeepFunc, typename VisitFunc>
+    static CSize compact(UThreadPoolPtr pool, CSize size, const KeepFunc& keep, const VisitFunc& visit) {
+        CSize chunkSize = calcChunkSize<T>(pool, size);
+        CSize chunkNum = (size + chunkSize - 1) / chunkSize;
+        std::vector<char> flags(size);    // 避免 vector<bool> 按位存储导致的并发写冲突
+        std::vector<CSize> counts(chunkNum + 1, 0);
+        parallel(pool, chunkNum, [&](CSize index) {
+            CSize begin = index * chunkSize;
+            CSize end = std::min(begin + chunkSize, size);
+            CSize count = 0;
+            for (CSize i = begin; i < end; i++) {
+                flags[i] = keep(i) ? 1 : 0;
+                count += flags[i];
+            }
+            counts[index + 1] = count;
+        });
+        for (CSize i = 1; i <= chunkNum; i++) {
+            counts[i] += counts[i - 1];
+        }
+
+        CSize total = counts[chunkNum];
+        parallel(pool, chunkNum, [&](CSize index) {
+            CSize begin = index * chunkSize;
+            CSize end = std::min(begin + chunkSize, size);
+            CSize pos = counts[index];
+            for (CSize i = begin; i < end; i++) {
+                visit(i, (CBool)flags[i], pos, total);
+                pos += flags[i];
+            }
+        });
+        return total;
+    }
+
+    /**
+     * 将缓存中的前size个元素，并行移回原区间
+     * @param pool
+     * @param buffer
+     * @param first
+     * @param size
+     */
+    template<typename T, typename RandomIt>
+    static CVoid moveBack(UThreadPoolPtr pool, std::vector<T>& buffer, RandomIt first, CSize size) {
+        CSize chunkSize = calcChunkSize<T>(pool, size);
+        parallel(pool, (size + chunkSize - 1) / chunkSize, [&](CSize index) {
+            CSize begin = index * chunkSize;
+            CSize end = std::min(begin + chunkSize, size);
+            std::move(buffer.begin() + begin, buffer.begin() + end, first + begin);
+        });
+    }
+};
+
+#endif //UPARALLELALGORITHMS_H
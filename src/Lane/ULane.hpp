@@ -0,0 +1,143 @@
+/***************************
+@File: ULane.h
+@Desc: 任务通道。不同通道的任务相互隔离，各自拥有队列、权重和专属线程
+       空闲线程按照权重，通过差额轮询（DRR）的方式选择通道
+***************************/
+
+#ifndef ULANE_H
+#define ULANE_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "../ThreadPoolinc.hpp"
+#include "../Queue/UAtomicQueue.hpp"
+#include "../Task/UTask.hpp"
+
+/**
+ * 通道统计信息
+ */
+struct ULaneStats {
+    CULong submitted_num_ = 0;                                   // 提交的任务个数
+    CULong popped_num_ = 0;                                      // 被取出执行的任务个数
+    CULong stolen_num_ = 0;                                      // 被非专属线程取出执行的任务个数
+    CSize pending_num_ = 0;                                      // 队列中等待的任务个数
+};
+
+
+class ULane {
+public:
+    explicit ULane(const std::string& name, CUint weight, int reservedSize)
+        : name_(name), weight_(std::max<CUint>(weight, 1)), reserved_size_(std::max(reservedSize, 0)) {}
+
+    /**
+     * 写入任务，不受容量限制
+     * @param task
+     */
+    CVoid push(UTask&& task) {
+        queue_.push(std::move(task));
+        submitted_num_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * 取出任务
+     * @param task
+     * @param stolen 是否由非专属线程取出
+     * @return
+     */
+    CBool tryPop(UTaskRef task, CBool stolen) {
+        if (!queue_.tryPop(task)) {
+            return false;
+        }
+
+        popped_num_.fetch_add(1, std::memory_order_relaxed);
+        if (stolen) {
+            stolen_num_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    /**
+     * 获取统计信息
+     * @return
+     */
+    ULaneStats getStats() {
+        ULaneStats stats;
+        stats.submitted_num_ = submitted_num_.load(std::memory_order_relaxed);
+        stats.popped_num_ = popped_num_.load(std::memory_order_relaxed);
+        stats.stolen_num_ = stolen_num_.load(std::memory_order_relaxed);
+        stats.pending_num_ = queue_.size();
+        return stats;
+    }
+
+    [[nodiscard]] const std::string& getName() const {
+        return name_;
+    }
+
+    [[nodiscard]] CUint getWeight() const {
+        return weight_;
+    }
+
+    [[nodiscard]] int getReservedSize() const {
+        return reserved_size_;
+    }
+
+    NO_ALLOWED_COPY(ULane)
+
+private:
+    std::string name_;                                           // 通道名称
+    CUint weight_ = 1;                                           // 权重，每轮最多连续取出的任务个数
+    int reserved_size_ = 0;                                      // 专属线程个数
+    UAtomicQueue<UTask> queue_;                                  // 通道内的任务
+    std::atomic<CULong> submitted_num_ { 0 };
+    std::atomic<CULong> popped_num_ { 0 };
+    std::atomic<CULong> stolen_num_ { 0 };
+};
+
+using ULanePtr = ULane *;
+
+
+/**
+ * 按照权重在多个通道中轮询取任务（deficit round robin），每个线程持有一份
+ * 每轮给当前通道补充 weight 个额度，取出一个任务消耗一个额度，通道为空时清零额度
+ */
+class ULaneScheduler {
+public:
+    /**
+     * 从通道中取出一个任务
+     * @param lanes
+     * @param skip 不需要参与轮询的通道（如专属通道已经单独取过）
+     * @param task
+     * @return
+     */
+    CBool pop(const std::vector<ULanePtr>& lanes, ULanePtr skip, UTaskRef task) {
+        CSize size = lanes.size();
+        for (CSize i = 0; i < size; i++) {
+            ULanePtr lane = lanes[cursor_ % size];
+            if (lane != skip) {
+                if (deficit_ <= 0) {
+                    deficit_ = lane->getWeight();
+                }
+
+                if (lane->tryPop(task, true)) {
+                    if (--deficit_ <= 0) {
+                        cursor_++;    // 额度用完，轮到下一个通道
+                    }
+                    return true;
+                }
+            }
+
+            deficit_ = 0;
+            cursor_++;
+        }
+
+        return false;
+    }
+
+private:
+    CSize cursor_ = 0;                                           // 当前轮询到的通道
+    CLong deficit_ = 0;                                          // 当前通道剩余的额度
+};
+
+#endif //ULANE_H
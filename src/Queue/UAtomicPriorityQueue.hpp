@@ -8,9 +8,12 @@
 #define UATOMICPRIORITYQUEUE_HPP
 
 #include <queue>
+#include <vector>
+#include <functional>
 
 #include "../ThreadPoolinc.hpp"
 #include "../CStdEx.hpp"
+#include "../UAllocator.hpp"
 
 template <typename T>
 class UAtomicPriorityQueue {
@@ -27,7 +30,7 @@ class UAtomicPriorityQueue {
         if (priority_queue_.empty()) {
             return false;
         }
-        value = std::move(*priority_queue_.top());
+        value = std::move(const_cast<T&>(priority_queue_.top()));    // 随后立即pop，可以安全移动
         priority_queue_.pop();
         return true;
     }
@@ -45,7 +48,7 @@ class UAtomicPriorityQueue {
         }
 
         while (!priority_queue_.empty() && maxPoolBatchSize--) {
-            values.emplace_back(std::move(*priority_queue_.top()));
+            values.emplace_back(std::move(const_cast<T&>(priority_queue_.top())));
             priority_queue_.pop();
         }
 
@@ -59,9 +62,8 @@ class UAtomicPriorityQueue {
      * @return
      */
     CVoid push(T&& value, int priority) {
-        std::unique_ptr<T> task(c_make_unique<T>(std::move(value), priority));
         LOCK_GUARD lk(mutex_);
-        priority_queue_.push(std::move(task));
+        priority_queue_.emplace(std::move(value), priority);
     }
 
     /**
@@ -76,8 +78,8 @@ class UAtomicPriorityQueue {
     NO_ALLOWED_COPY(UAtomicPriorityQueue)
 
    private:
-    std::priority_queue<std::unique_ptr<T> >
-        priority_queue_;  // 优先队列信息，根据重要级别决定先后执行顺序
+    // 优先队列信息，根据重要级别决定先后执行顺序，数值大的先执行
+    std::priority_queue<T, std::vector<T, UArenaAllocator<T>>, std::greater<T>> priority_queue_;
     std::mutex mutex_;
     std::condition_variable cv_;
 };
@@ -10,9 +10,16 @@
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <deque>
+#include <vector>
+#include <chrono>
+#include <atomic>
 
 #include "../ThreadPoolinc.hpp"
 #include "../CStdEx.hpp"
+#include "../UAllocator.hpp"
+#include "./UQueueWatermark.hpp"
+#include "../UTrace.hpp"
 
 template <typename T>
 class UAtomicQueue {
@@ -24,10 +31,18 @@ class UAtomicQueue {
      * @param value
      */
     CVoid waitPop(T& value) {
-        UNIQUE_LOCK lk(mutex_);
-        cv_.wait(lk, [this] { return !queue_.empty(); });
-        value = std::move(*queue_.front());
-        queue_.pop();
+        CSize size = 0;
+        CBool low = false;
+        {
+            UNIQUE_LOCK lk(mutex_);
+            cv_.wait(lk, [this] { return !queue_.empty(); });
+            value = std::move(queue_.front());
+            queue_.pop();
+            UTHREADPOOL_TRACE(queue_pop, UTHREADPOOL_TRACE_ID(value), queue_.size());
+            size = queue_.size();
+            low = watermark_.checkLow(size);
+        }
+        afterPop(low, size);
     }
 
     /**
@@ -36,12 +51,20 @@ class UAtomicQueue {
      * @return
      */
     CBool tryPop(T& value) {
-        LOCK_GUARD lk(mutex_);
-        if (queue_.empty()) {
-            return false;
+        CSize size = 0;
+        CBool low = false;
+        {
+            LOCK_GUARD lk(mutex_);
+            if (queue_.empty()) {
+                return false;
+            }
+            value = std::move(queue_.front());
+            queue_.pop();
+            UTHREADPOOL_TRACE(queue_pop, UTHREADPOOL_TRACE_ID(value), queue_.size());
+            size = queue_.size();
+            low = watermark_.checkLow(size);
         }
-        value = std::move(*queue_.front());
-        queue_.pop();
+        afterPop(low, size);
         return true;
     }
 
@@ -52,16 +75,23 @@ class UAtomicQueue {
      * @return
      */
     CBool tryPop(std::vector<T>& values, int maxPoolBatchSize) {
-        LOCK_GUARD lk(mutex_);
-        if (queue_.empty() || maxPoolBatchSize <= 0) {
-            return false;
-        }
+        CSize size = 0;
+        CBool low = false;
+        {
+            LOCK_GUARD lk(mutex_);
+            if (queue_.empty() || maxPoolBatchSize <= 0) {
+                return false;
+            }
 
-        while (!queue_.empty() && maxPoolBatchSize--) {
-            values.emplace_back(std::move(*queue_.front()));
-            queue_.pop();
+            while (!queue_.empty() && maxPoolBatchSize--) {
+                values.emplace_back(std::move(queue_.front()));
+                queue_.pop();
+                UTHREADPOOL_TRACE(queue_pop, UTHREADPOOL_TRACE_ID(values.back()), queue_.size());
+            }
+            size = queue_.size();
+            low = watermark_.checkLow(size);
         }
-
+        afterPop(low, size);
         return true;
     }
 
@@ -70,10 +100,19 @@ class UAtomicQueue {
      * @return
      */
     std::unique_ptr<T> waitPop() {
-        UNIQUE_LOCK lk(mutex_);
-        cv_.wait(lk, [this] { return !queue_.empty(); });
-        std::unique_ptr<T> result = std::move(queue_.front());
-        queue_.pop();
+        std::unique_ptr<T> result;
+        CSize size = 0;
+        CBool low = false;
+        {
+            UNIQUE_LOCK lk(mutex_);
+            cv_.wait(lk, [this] { return !queue_.empty(); });
+            result = c_make_unique<T>(std::move(queue_.front()));
+            queue_.pop();
+            UTHREADPOOL_TRACE(queue_pop, UTHREADPOOL_TRACE_ID(*result), queue_.size());
+            size = queue_.size();
+            low = watermark_.checkLow(size);
+        }
+        afterPop(low, size);
         return result;
     }
 
@@ -82,24 +121,134 @@ class UAtomicQueue {
      * @return
      */
     std::unique_ptr<T> tryPop() {
-        LOCK_GUARD lk(mutex_);
-        if (queue_.empty()) {
-            return std::unique_ptr<T>();
+        std::unique_ptr<T> ptr;
+        CSize size = 0;
+        CBool low = false;
+        {
+            LOCK_GUARD lk(mutex_);
+            if (queue_.empty()) {
+                return std::unique_ptr<T>();
+            }
+            ptr = c_make_unique<T>(std::move(queue_.front()));
+            queue_.pop();
+            UTHREADPOOL_TRACE(queue_pop, UTHREADPOOL_TRACE_ID(*ptr), queue_.size());
+            size = queue_.size();
+            low = watermark_.checkLow(size);
         }
-        std::unique_ptr<T> ptr = std::move(queue_.front());
-        queue_.pop();
+        afterPop(low, size);
         return ptr;
     }
 
     /**
-     * 传入数据
+     * 传入数据，不受容量限制
      * @param value
      */
     CVoid push(T&& value) {
-        std::unique_ptr<T> task(c_make_unique<T>(std::move(value)));
+        CSize size = 0;
+        CBool high = false;
+        {
+            LOCK_GUARD lk(mutex_);
+            UTHREADPOOL_TRACE(queue_push, UTHREADPOOL_TRACE_ID(value), queue_.size());
+            queue_.push(std::move(value));
+            size = queue_.size();
+            high = watermark_.checkHigh(size);
+            cv_.notify_one();
+        }
+        if (high) {
+            watermark_.notify(true, size);
+        }
+    }
+
+    /**
+     * 尝试传入数据。队列已满时返回false，且value保持不变
+     * @param value
+     * @return
+     */
+    CBool tryPush(T&& value) {
+        return waitPush(std::move(value), 0);
+    }
+
+    /**
+     * 等待传入数据。超过ttl仍然已满时返回false，且value保持不变
+     * @param value
+     * @param ttl 最大等待时间，单位为ms
+     * @return
+     */
+    CBool waitPush(T&& value, CMSec ttl) {
+        CSize size = 0;
+        CBool high = false;
+        {
+            UNIQUE_LOCK lk(mutex_);
+            if (isFull()) {
+                push_waiters_++;
+                not_full_cv_.wait_for(lk, std::chrono::milliseconds(ttl), [this] { return !isFull(); });
+                push_waiters_--;
+                if (isFull()) {
+                    return false;    // 写入失败，value保持不变
+                }
+            }
+
+            UTHREADPOOL_TRACE(queue_push, UTHREADPOOL_TRACE_ID(value), queue_.size());
+            queue_.push(std::move(value));
+            size = queue_.size();
+            high = watermark_.checkHigh(size);
+            cv_.notify_one();
+        }
+        if (high) {
+            watermark_.notify(true, size);
+        }
+        return true;
+    }
+
+    /**
+     * 批量传入数据，仅加一次锁，不受容量限制。写入后清空values
+     * @param values
+     */
+    CVoid push(std::vector<T>& values) {
+        if (values.empty()) {
+            return;
+        }
+
+        CSize size = 0;
+        CBool high = false;
+        {
+            LOCK_GUARD lk(mutex_);
+            for (auto& value : values) {
+                UTHREADPOOL_TRACE(queue_push, UTHREADPOOL_TRACE_ID(value), queue_.size());
+                queue_.push(std::move(value));
+            }
+            size = queue_.size();
+            high = watermark_.checkHigh(size);
+            cv_.notify_all();
+        }
+
+        values.clear();
+        if (high) {
+            watermark_.notify(true, size);
+        }
+    }
+
+    /**
+     * 设置容量，为0表示不限制。需要在队列使用前设置
+     * @param capacity
+     * @return
+     */
+    UAtomicQueue* setCapacity(CSize capacity) {
         LOCK_GUARD lk(mutex_);
-        queue_.push(std::move(task));
-        cv_.notify_one();
+        capacity_ = capacity;
+        return this;
+    }
+
+    /**
+     * 设置高低水位信息。需要在队列使用前设置
+     * @return
+     */
+    UAtomicQueue* setWatermark(CIndex index, CSize high, CSize low,
+                               const UWatermarkCallback& onHigh,
+                               const UWatermarkCallback& onLow) {
+        LOCK_GUARD lk(mutex_);
+        watermark_.setWatermark(index, high, low, onHigh, onLow);
+        return this;
     }
 
     /**
@@ -111,12 +260,44 @@ class UAtomicQueue {
         return queue_.empty();
     }
 
+    /**
+     * 获取队列长度
+     * @return
+     */
+    [[nodiscard]] CSize size() {
+        LOCK_GUARD lk(mutex_);
+        return queue_.size();
+    }
+
     NO_ALLOWED_COPY(UAtomicQueue)
 
    private:
-    std::queue<std::unique_ptr<T>> queue_;
+    CBool isFull() const {
+        return capacity_ > 0 && queue_.size() >= capacity_;
+    }
+
+    /**
+     * 弹出后的处理，需要在锁外调用
+     * @param low
+     * @param size
+     */
+    CVoid afterPop(CBool low, CSize size) {
+        if (push_waiters_ > 0) {
+            not_full_cv_.notify_all();    // 批量弹出时可能空出多个位置
+        }
+        if (low) {
+            watermark_.notify(false, size);
+        }
+    }
+
+   private:
+    std::queue<T, std::deque<T, UArenaAllocator<T>>> queue_;    // 直接存放数据，节点内存来自arena
     std::mutex mutex_;
     std::condition_variable cv_;
+    std::condition_variable not_full_cv_;                        // 队列未满的条件变量，仅在有限容量时使用
+    std::atomic<CInt> push_waiters_ { 0 };                       // 等待写入的线程数
+    CSize capacity_ = 0;                                         // 队列容量，为0表示不限制
+    UQueueWatermark watermark_;                                  // 高低水位信息
 };
 
 #endif  // UATOMICQUEUE_H
@@ -1,6 +1,8 @@
 /***************************
 @File: UAtomicRingBufferQueue.h
-@Desc: 本 queue 仅支持单入单出模式
+@Desc: 无锁环形队列，支持多入多出（MPMC）和单入单出（SPSC）两种模式
+       数据直接存放在槽位中，每个槽位通过序号标记读写状态
+       仅在队列为空或已满时，阻塞接口才会进入等待
 ***************************/
 
 #ifndef UATOMICRINGBUFFERQUEUE_H
@@ -8,19 +10,37 @@
 
 #include <vector>
 #include <atomic>
+#include <memory>
+#include <chrono>
+#include <condition_variable>
 
 #include "../ThreadPoolinc.hpp"
 #include "../CFuncType.hpp"
 #include "../CStdEx.hpp"
 
-template<typename T, CUint capacity = DEFAULT_RINGBUFFER_SIZE>
+/**
+ * 环形队列的读写模式
+ */
+enum class URingBufferMode {
+    MPMC = 0,              /** 多入多出 */
+    SPSC = 1,              /** 单入单出，读写位置无需CAS */
+};
+
+template<typename T,
+         CUint capacity = DEFAULT_RINGBUFFER_SIZE,
+         URingBufferMode mode = URingBufferMode::MPMC>
 class UAtomicRingBufferQueue {
+    static const CSize CACHE_LINE_SIZE = 64;
+    static const CInt MAX_SPIN_TIMES = 64;                          // 进入等待之前的自旋次数
+
+    struct URingBufferCell {
+        std::atomic<CSize> seq_ { 0 };                              // 槽位序号，用于判断是否可读写
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_;
+    };
+
 public:
     explicit UAtomicRingBufferQueue() {
-        head_ = 0;
-        tail_ = 0;
-        capacity_ = capacity;
-        ring_buffer_queue_.resize(capacity_);
+        setCapacity(capacity);
     }
 
     ~UAtomicRingBufferQueue() {
@@ -28,14 +48,26 @@ public:
     }
 
     /**
-     * 设置容量信息
+     * 设置容量信息，实际容量为不小于size的2的幂
      * @param size
      * @return
-     * @notice 谨慎使用，push信息之后，不推荐使用
+     * @notice 仅可在队列未使用时调用，会清空已有数据
      */
     UAtomicRingBufferQueue* setCapacity(CUint size) {
-        capacity_ = size;
-        ring_buffer_queue_.resize(capacity_);
+        clear();
+        CSize real = 2;
+        while (real < size) {
+            real <<= 1;
+        }
+
+        capacity_ = real;
+        mask_ = real - 1;
+        cells_.reset(new URingBufferCell[real]);
+        for (CSize i = 0; i < real; i++) {
+            cells_[i].seq_.store(i, std::memory_order_relaxed);
+        }
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
         return this;
     }
 
@@ -44,26 +76,121 @@ public:
      * @return
      */
     [[nodiscard]] CUint getCapacity() const {
-        return capacity_;
+        return (CUint)capacity_;
+    }
+
+    /**
+     * 尝试写入信息，队列已满时返回false
+     * @param value 写入失败时保持不变
+     * @return
+     */
+    template<class U>
+    CBool tryPush(U&& value) {
+        CBool result = pushOne(std::forward<U>(value));
+        if (result) {
+            notifyPop();
+        }
+        return result;
+    }
+
+    /**
+     * 尝试弹出信息，队列为空时返回false
+     * @param value
+     * @return
+     */
+    CBool tryPop(T& value) {
+        CBool result = popOne(value);
+        if (result) {
+            notifyPush();
+        }
+        return result;
+    }
+
+    /**
+     * 批量写入信息，连续的空闲槽位通过一次CAS获取
+     * @param values 写入成功的部分会从头部移除
+     * @return 写入的个数
+     */
+    CSize tryPush(std::vector<T>& values) {
+        CSize pos = 0;
+        CSize size = claim(tail_, pos, values.size(), 0);
+        for (CSize i = 0; i < size; i++) {
+            auto& cell = cells_[(pos + i) & mask_];
+            new (&cell.storage_) T(std::move(values[i]));
+            cell.seq_.store(pos + i + 1, std::memory_order_release);
+        }
+
+        if (size > 0) {
+            values.erase(values.begin(), values.begin() + size);
+            notifyPop();
+        }
+        return size;
+    }
+
+    /**
+     * 批量弹出信息，连续的可读槽位通过一次CAS获取
+     * @param values
+     * @param maxSize
+     * @return 弹出的个数
+     */
+    CSize tryPop(std::vector<T>& values, CSize maxSize) {
+        CSize pos = 0;
+        CSize size = claim(head_, pos, maxSize, 1);
+        for (CSize i = 0; i < size; i++) {
+            T* ptr = slot(pos + i);
+            values.emplace_back(std::move(*ptr));
+            release(pos + i, ptr);
+        }
+
+        if (size > 0) {
+            notifyPush();
+        }
+        return size;
     }
 
     /**
-     * 写入信息
+     * 写入信息，队列已满时等待
      * @param value
      * @return
      */
-    template<class TImpl = T>
-    CVoid push(const TImpl& value) {
+    CVoid push(const T& value) {
+        T copy(value);
+        push(std::move(copy));
+    }
+
+    CVoid push(T&& value) {
+        while (!waitPush(std::move(value), MAX_BLOCK_TTL)) {
+        }
+    }
+
+    /**
+     * 等待写入信息
+     * @param value
+     * @param ttl 最大等待时间，单位为ms
+     * @return 超时仍未写入，返回false
+     */
+    CBool waitPush(T&& value, CMSec ttl) {
+        for (CInt i = 0; i < MAX_SPIN_TIMES; i++) {
+            if (tryPush(std::move(value))) {
+                return true;
+            }
+            std::this_thread::yield();
+        }
+
+        CBool result = false;
         {
             UNIQUE_LOCK lk(mutex_);
-            if (isFull()) {
-                push_cv_.wait(lk, [this] { return !isFull(); });
-            }
+            push_waiters_.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            result = push_cv_.wait_for(lk, std::chrono::milliseconds(ttl),
+                                       [&] { return pushOne(std::move(value)); });
+            push_waiters_.fetch_sub(1);
+        }
 
-            ring_buffer_queue_[tail_] = std::move(c_make_unique<TImpl>(value));
-            tail_ = (tail_ + 1) % capacity_;
+        if (result) {
+            notifyPop();    // 在锁外通知，避免重入
         }
-        pop_cv_.notify_one();
+        return result;
     }
 
     /**
@@ -71,57 +198,172 @@ public:
      * @param value
      * @return
      */
-    template<class TImpl = T>
-    CVoid waitPop(TImpl& value) {
+    CVoid waitPop(T& value) {
+        waitPop(value, MAX_BLOCK_TTL);
+    }
+
+    /**
+     * 等待弹出信息
+     * @param value
+     * @param ttl 最大等待时间，单位为ms
+     * @return 超时仍未弹出，返回false
+     */
+    CBool waitPop(T& value, CMSec ttl) {
+        for (CInt i = 0; i < MAX_SPIN_TIMES; i++) {
+            if (tryPop(value)) {
+                return true;
+            }
+            std::this_thread::yield();
+        }
+
+        CBool result = false;
         {
             UNIQUE_LOCK lk(mutex_);
-            if (isEmpty()) {
-                pop_cv_.wait(lk, [this] { return !isEmpty(); });
-            }
+            pop_waiters_.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            result = pop_cv_.wait_for(lk, std::chrono::milliseconds(ttl),
+                                      [&] { return popOne(value); });
+            pop_waiters_.fetch_sub(1);
+        }
 
-            value = (*ring_buffer_queue_[head_]);
-            *ring_buffer_queue_[head_] = {};
-            head_ = (head_ + 1) % capacity_;
+        if (result) {
+            notifyPush();
         }
-        push_cv_.notify_one();
+        return result;
+    }
+
+    /**
+     * 判断是否为空，仅为近似值
+     * @return
+     */
+    [[nodiscard]] CBool empty() const {
+        return head_.load(std::memory_order_acquire) >= tail_.load(std::memory_order_acquire);
     }
 
     /**
      * 清空所有的数据
      * @return
+     * @notice 非线程安全，需要确认没有其他线程在读写
      */
     CStatus clear() {
         FUNCTION_BEGIN
-        ring_buffer_queue_.resize(0);
-        head_ = 0;
-        tail_ = 0;
+        CSize pos = 0;
+        while (cells_ && claim(head_, pos, 1, 1) > 0) {
+            release(pos, slot(pos));
+        }
         FUNCTION_END
     }
 
-protected:
-    CBool isFull() {
-        // 空出来一个位置，这个时候不让 tail写入
-        return head_ == (tail_ + 1) % capacity_;
+    NO_ALLOWED_COPY(UAtomicRingBufferQueue)
+
+private:
+    /**
+     * 获取连续可用的槽位
+     * @param position 读或写的位置
+     * @param pos 获取到的起始位置
+     * @param maxSize 最多获取的个数
+     * @param offset 写入为0，读取为1
+     * @return 获取到的个数
+     */
+    CSize claim(std::atomic<CSize>& position, CSize& pos, CSize maxSize, CSize offset) {
+        pos = position.load(std::memory_order_relaxed);
+        while (maxSize > 0) {
+            CSize size = 0;
+            while (size < maxSize && size < capacity_) {
+                CSize seq = cells_[(pos + size) & mask_].seq_.load(std::memory_order_acquire);
+                if (seq != pos + size + offset) {
+                    break;
+                }
+                size++;
+            }
+
+            if (0 == size) {
+                CSize seq = cells_[pos & mask_].seq_.load(std::memory_order_acquire);
+                if ((std::ptrdiff_t)(seq - (pos + offset)) < 0) {
+                    return 0;    // 写入时表示已满，读取时表示为空
+                }
+                pos = position.load(std::memory_order_relaxed);    // 被其他线程抢先，重新读取位置
+                continue;
+            }
+
+            if (URingBufferMode::SPSC == mode) {
+                position.store(pos + size, std::memory_order_relaxed);
+                return size;
+            }
+            if (position.compare_exchange_weak(pos, pos + size, std::memory_order_relaxed)) {
+                return size;
+            }
+        }
+        return 0;
     }
 
-    CBool isEmpty() {
-        return head_ == tail_;
+    template<class U>
+    CBool pushOne(U&& value) {
+        CSize pos = 0;
+        if (0 == claim(tail_, pos, 1, 0)) {
+            return false;
+        }
+
+        auto& cell = cells_[pos & mask_];
+        new (&cell.storage_) T(std::forward<U>(value));
+        cell.seq_.store(pos + 1, std::memory_order_release);
+        return true;
     }
 
-    NO_ALLOWED_COPY(UAtomicRingBufferQueue)
+    CBool popOne(T& value) {
+        CSize pos = 0;
+        if (0 == claim(head_, pos, 1, 1)) {
+            return false;
+        }
 
-private:
-    CUint head_;                                                    // 头结点位置
-    CUint tail_;                                                    // 尾结点位置
-    CUint capacity_;                                                // 环形缓冲的容量大小
+        T* ptr = slot(pos);
+        value = std::move(*ptr);
+        release(pos, ptr);
+        return true;
+    }
 
-    std::condition_variable push_cv_;                               // 写入的条件变量。为了保持语义完整，也考虑今后多入多出的可能性，不使用 父类中的 cv_了
-    std::condition_variable pop_cv_;                                // 读取的条件变量
+    T* slot(CSize pos) {
+        return reinterpret_cast<T*>(&cells_[pos & mask_].storage_);
+    }
 
-    std::vector<std::unique_ptr<T> > ring_buffer_queue_;            // 环形缓冲区
+    /**
+     * 析构槽位中的数据，并标记为可写入
+     * @param pos
+     * @param ptr
+     */
+    CVoid release(CSize pos, T* ptr) {
+        ptr->~T();
+        cells_[pos & mask_].seq_.store(pos + capacity_, std::memory_order_release);
+    }
+
+    CVoid notifyPop() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (pop_waiters_.load(std::memory_order_relaxed) > 0) {
+            LOCK_GUARD lk(mutex_);
+            pop_cv_.notify_one();
+        }
+    }
+
+    CVoid notifyPush() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (push_waiters_.load(std::memory_order_relaxed) > 0) {
+            LOCK_GUARD lk(mutex_);
+            push_cv_.notify_one();
+        }
+    }
+
+private:
+    alignas(CACHE_LINE_SIZE) std::atomic<CSize> head_ { 0 };       // 读取位置
+    alignas(CACHE_LINE_SIZE) std::atomic<CSize> tail_ { 0 };       // 写入位置
+    alignas(CACHE_LINE_SIZE) CSize capacity_ = 0;                  // 环形缓冲的容量大小
+    CSize mask_ = 0;
+    std::unique_ptr<URingBufferCell[]> cells_;                     // 环形缓冲区
 
+    std::atomic<CInt> push_waiters_ { 0 };                         // 等待写入的线程数
+    std::atomic<CInt> pop_waiters_ { 0 };                          // 等待读取的线程数
+    std::condition_variable push_cv_;                              // 写入的条件变量
+    std::condition_variable pop_cv_;                               // 读取的条件变量
     std::mutex mutex_;
-    std::condition_variable cv_;
 };
 
 #endif //UATOMICRINGBUFFERQUEUE_H
@@ -0,0 +1,107 @@
+/***************************
+@File: UMailbox.h
+@Desc: 单任务信箱。提交方发现空闲线程时，将任务直接写入其信箱，跳过所有队列
+       写入和取出均通过一次CAS抢占
+***************************/
+
+#ifndef UMAILBOX_H
+#define UMAILBOX_H
+
+#include <atomic>
+#include <thread>
+
+#include "../ThreadPoolinc.hpp"
+#include "../Task/UTask.hpp"
+
+class alignas(64) UMailbox {
+    enum UMailboxState {
+        MAILBOX_EMPTY = 0,                                       // 可以写入
+        MAILBOX_WRITING = 1,                                     // 正在写入或取出
+        MAILBOX_FULL = 2,                                        // 等待被取出
+        MAILBOX_CLOSED = 3,                                      // 所属线程未运行，拒绝写入
+    };
+
+public:
+    explicit UMailbox() = default;
+
+    /**
+     * 尝试写入任务，可以在任意线程中调用
+     * @param task 仅在写入成功时被移走
+     * @return
+     */
+    CBool tryPut(UTask& task) {
+        int expected = MAILBOX_EMPTY;
+        if (!state_.compare_exchange_strong(expected, MAILBOX_WRITING, std::memory_order_acquire)) {
+            return false;
+        }
+
+        task_ = std::move(task);
+        state_.store(MAILBOX_FULL, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * 取出任务。主要由所属线程调用，所属线程未被调度时，其他空闲线程也可以取出
+     * @param task
+     * @return
+     */
+    CBool tryTake(UTaskRef task) {
+        int expected = MAILBOX_FULL;
+        if (MAILBOX_FULL != state_.load(std::memory_order_relaxed)
+            || !state_.compare_exchange_strong(expected, MAILBOX_WRITING, std::memory_order_acquire)) {
+            return false;
+        }
+
+        task = std::move(task_);
+        state_.store(MAILBOX_EMPTY, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * 所属线程启动时调用，开始接收任务
+     */
+    CVoid open() {
+        state_.store(MAILBOX_EMPTY, std::memory_order_release);
+    }
+
+    /**
+     * 所属线程是否在运行，即信箱是否接收写入
+     * @return
+     */
+    [[nodiscard]] CBool isOpen() const {
+        return MAILBOX_CLOSED != state_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * 所属线程停止后调用，拒绝之后的写入
+     * @param task 信箱中残留的任务
+     * @return 是否有残留的任务
+     */
+    CBool close(UTaskRef task) {
+        while (true) {
+            int state = state_.load(std::memory_order_acquire);
+            if (MAILBOX_WRITING == state) {
+                std::this_thread::yield();    // 等待正在进行的写入或取出完成
+            } else if (MAILBOX_FULL == state) {
+                if (state_.compare_exchange_weak(state, MAILBOX_WRITING, std::memory_order_acquire)) {
+                    task = std::move(task_);
+                    state_.store(MAILBOX_CLOSED, std::memory_order_release);
+                    return true;
+                }
+            } else if (MAILBOX_CLOSED == state
+                       || state_.compare_exchange_weak(state, MAILBOX_CLOSED, std::memory_order_acq_rel)) {
+                return false;
+            }
+        }
+    }
+
+    NO_ALLOWED_COPY(UMailbox)
+
+private:
+    std::atomic<int> state_ { MAILBOX_CLOSED };
+    UTask task_;
+};
+
+using UMailboxPtr = UMailbox *;
+
+#endif //UMAILBOX_H
@@ -0,0 +1,103 @@
+/***************************
+@File: UMpscQueue.h
+@Desc: 多入单出无锁队列（Vyukov）。写入只需一次exchange，不会自旋等待
+       弹出仅允许在单一线程中进行
+***************************/
+
+#ifndef UMPSCQUEUE_H
+#define UMPSCQUEUE_H
+
+#include <atomic>
+
+#include "../ThreadPoolinc.hpp"
+#include "../UAllocator.hpp"
+
+template<typename T>
+class UMpscQueue {
+    struct UMpscNode {
+        std::atomic<UMpscNode *> next_ { nullptr };
+        T value_;
+
+        explicit UMpscNode() = default;
+
+        explicit UMpscNode(T&& value) : value_(std::move(value)) {}
+
+        // 节点从线程级arena中申请，由消费线程释放
+        static void* operator new(CSize size) {
+            return UAllocator::arenaMalloc(size);
+        }
+
+        static CVoid operator delete(void* ptr) {
+            UAllocator::arenaFree(ptr);
+        }
+    };
+
+public:
+    explicit UMpscQueue() {
+        auto stub = new UMpscNode();
+        head_.store(stub, std::memory_order_relaxed);
+        tail_ = stub;
+    }
+
+    ~UMpscQueue() {
+        T value;
+        while (tryPop(value)) {
+        }
+        delete tail_;
+    }
+
+    /**
+     * 写入信息，可以在任意线程中调用
+     * @param value
+     */
+    CVoid push(T&& value) {
+        auto node = new UMpscNode(std::move(value));
+        size_.fetch_add(1, std::memory_order_relaxed);    // 先计数再链接，长度只会暂时偏大，不会下溢
+        UMpscNode* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next_.store(node, std::memory_order_release);
+    }
+
+    /**
+     * 弹出信息，仅可在消费线程中调用
+     * 写入方已经交换head_但尚未链接时，会暂时返回false
+     * @param value
+     * @return
+     */
+    CBool tryPop(T& value) {
+        UMpscNode* next = tail_->next_.load(std::memory_order_acquire);
+        if (nullptr == next) {
+            return false;
+        }
+
+        value = std::move(next->value_);
+        delete tail_;
+        tail_ = next;    // next成为新的哨兵节点
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * 判断是否为空，仅可在消费线程中调用
+     * @return
+     */
+    [[nodiscard]] CBool empty() const {
+        return nullptr == tail_->next_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * 获取队列的近似长度，可以在任意线程中调用
+     * @return
+     */
+    [[nodiscard]] CSize size() const {
+        return size_.load(std::memory_order_relaxed);
+    }
+
+    NO_ALLOWED_COPY(UMpscQueue)
+
+private:
+    std::atomic<UMpscNode *> head_ { nullptr };                  // 最新写入的节点，由写入方竞争
+    UMpscNode* tail_ = nullptr;                                  // 哨兵节点，仅消费线程访问
+    std::atomic<CSize> size_ { 0 };                              // 近似长度，写入时先增加
+};
+
+#endif //UMPSCQUEUE_H
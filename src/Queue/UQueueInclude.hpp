@@ -9,5 +9,8 @@
 #include "./UWorkStealingQueue.hpp"
 #include "./UAtomicPriorityQueue.hpp"
 #include "./UAtomicRingBufferQueue.hpp"
+#include "./UMpscQueue.hpp"
+#include "./UMailbox.hpp"
+#include "./UQueueWatermark.hpp"
 
 #endif //CGRAPH_UQUEUEINCLUDE_H
@@ -0,0 +1,85 @@
+/***************************
+@File: UQueueWatermark.h
+@Desc: 队列高低水位检测。超过高水位和回落到低水位时，各通知一次，
+       便于上游在延迟恶化之前进行限流
+***************************/
+
+#ifndef UQUEUEWATERMARK_H
+#define UQUEUEWATERMARK_H
+
+#include <functional>
+#include <algorithm>
+
+#include "../ThreadPoolinc.hpp"
+
+using UWatermarkCallback = std::function<CVoid(CIndex, CSize)>;    // 参数为队列index(pool的queue为-1)和当前长度
+
+class UQueueWatermark {
+public:
+    /**
+     * 设置水位信息，需要在队列使用前设置
+     * @param index 队列标识
+     * @param high 高水位，为0表示不开启
+     * @param low 低水位
+     * @param onHigh
+     * @param onLow
+     */
+    CVoid setWatermark(CIndex index, CSize high, CSize low,
+                       const UWatermarkCallback& onHigh,
+                       const UWatermarkCallback& onLow) {
+        index_ = index;
+        high_ = high;
+        low_ = std::min(low, high);
+        on_high_ = onHigh;
+        on_low_ = onLow;
+        above_ = false;
+    }
+
+    /**
+     * 写入后检测，需要在队列锁内调用
+     * @param size
+     * @return 是否需要触发高水位通知
+     */
+    CBool checkHigh(CSize size) {
+        if (0 == high_ || above_ || size < high_) {
+            return false;
+        }
+        above_ = true;
+        return true;
+    }
+
+    /**
+     * 弹出后检测，需要在队列锁内调用
+     * @param size
+     * @return 是否需要触发低水位通知
+     */
+    CBool checkLow(CSize size) {
+        if (!above_ || size > low_) {
+            return false;
+        }
+        above_ = false;
+        return true;
+    }
+
+    /**
+     * 触发通知，需要在队列锁外调用
+     * @param high
+     * @param size
+     */
+    CVoid notify(CBool high, CSize size) const {
+        const auto& callback = high ? on_high_ : on_low_;
+        if (callback) {
+            callback(index_, size);
+        }
+    }
+
+private:
+    CIndex index_ = DEFAULT_TASK_STRATEGY;                       // 队列标识
+    CSize high_ = 0;                                             // 高水位
+    CSize low_ = 0;                                              // 低水位
+    CBool above_ = false;                                        // 当前是否处于高水位之上
+    UWatermarkCallback on_high_ = nullptr;
+    UWatermarkCallback on_low_ = nullptr;
+};
+
+#endif //UQUEUEWATERMARK_H
@@ -9,27 +9,130 @@
 
 #include <queue>
 #include <deque>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
 
 #include "../USpinLock.hpp"
 #include "../ThreadPoolinc.hpp"
 #include "../Task/UTask.hpp"
+#include "../UAllocator.hpp"
+#include "./UQueueWatermark.hpp"
+#include "../UTrace.hpp"
 
 class UWorkStealingQueue {
 public:
     /**
-     * 向队列中写入信息
+     * 向队列中写入信息，不受容量限制
      * @param task
      */
     CVoid push(UTask&& task) {
+        CBool high = false;
+        CSize size = 0;
         while (true) {
             if (lock_.tryLock()) {
+                UTHREADPOOL_TRACE(wsq_push, task.getTraceId(), deque_.size());
                 deque_.emplace_front(std::move(task));
+                size = updateSize();
+                high = watermark_.checkHigh(size);
                 lock_.unlock();
                 break;
             } else {
                 std::this_thread::yield();
             }
         }
+
+        if (high) {
+            watermark_.notify(true, size);
+        }
+    }
+
+
+    /**
+     * 批量写入信息，只加锁一次，不受容量限制。写入后清空taskArr
+     * @param taskArr
+     */
+    CVoid push(UTaskArrRef taskArr) {
+        CBool high = false;
+        CSize size = 0;
+        while (true) {
+            if (lock_.tryLock()) {
+                for (auto& task : taskArr) {
+                    UTHREADPOOL_TRACE(wsq_push, task.getTraceId(), deque_.size());
+                    deque_.emplace_front(std::move(task));
+                }
+                size = updateSize();
+                high = watermark_.checkHigh(size);
+                lock_.unlock();
+                break;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+
+        taskArr.clear();
+        if (high) {
+            watermark_.notify(true, size);
+        }
+    }
+
+
+    /**
+     * 尝试向队列中写入信息。队列已满时返回false，且task保持不变
+     * @param task
+     * @return
+     */
+    CBool tryPush(UTask&& task) {
+        CBool high = false;
+        CSize size = 0;
+        while (true) {
+            if (lock_.tryLock()) {
+                if (capacity_ > 0 && deque_.size() >= capacity_) {
+                    lock_.unlock();
+                    return false;
+                }
+                UTHREADPOOL_TRACE(wsq_push, task.getTraceId(), deque_.size());
+                deque_.emplace_front(std::move(task));
+                size = updateSize();
+                high = watermark_.checkHigh(size);
+                lock_.unlock();
+                break;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+
+        if (high) {
+            watermark_.notify(true, size);
+        }
+        return true;
+    }
+
+
+    /**
+     * 等待写入信息。超过ttl仍然已满时返回false，且task保持不变
+     * @param task
+     * @param ttl 最大等待时间，单位为ms
+     * @return
+     */
+    CBool waitPush(UTask&& task, CMSec ttl) {
+        if (tryPush(std::move(task))) {
+            return true;
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ttl);
+        CBool result = false;
+        UNIQUE_LOCK lk(mutex_);
+        push_waiters_++;    // 先登记再重试，弹出方在释放自旋锁之后检查，不会丢失通知
+        while (!(result = tryPush(std::move(task)))) {
+            if (std::cv_status::timeout == not_full_cv_.wait_until(lk, deadline)) {
+                result = tryPush(std::move(task));
+                break;
+            }
+        }
+        push_waiters_--;
+        return result;
     }
 
 
@@ -41,15 +144,21 @@ public:
     CBool tryPop(UTask& task) {
         // 这里不使用raii锁，主要是考虑到多线程的情况下，可能会重复进入
         bool result = false;
+        CBool low = false;
+        CSize size = 0;
         if (lock_.tryLock()) {
             if (!deque_.empty()) {
                 task = std::move(deque_.front());    // 从前方弹出
                 deque_.pop_front();
+                UTHREADPOOL_TRACE(wsq_pop, task.getTraceId(), deque_.size());
+                size = updateSize();
+                low = watermark_.checkLow(size);
                 result = true;
             }
             lock_.unlock();
         }
 
+        afterPop(result, low, size);
         return result;
     }
 
@@ -63,15 +172,21 @@ public:
     CBool tryPop(UTaskArrRef taskArr,
                  int maxLocalBatchSize) {
         bool result = false;
+        CBool low = false;
+        CSize size = 0;
         if (lock_.tryLock()) {
             while (!deque_.empty() && maxLocalBatchSize--) {
                 taskArr.emplace_back(std::move(deque_.front()));
                 deque_.pop_front();
+                UTHREADPOOL_TRACE(wsq_pop, taskArr.back().getTraceId(), deque_.size());
                 result = true;
             }
+            size = updateSize();
+            low = result && watermark_.checkLow(size);
             lock_.unlock();
         }
 
+        afterPop(result, low, size);
         return result;
     }
 
@@ -83,15 +198,21 @@ public:
      */
     CBool trySteal(UTask& task) {
         bool result = false;
+        CBool low = false;
+        CSize size = 0;
         if (lock_.tryLock()) {
             if (!deque_.empty()) {
                 task = std::move(deque_.back());    // 从后方窃取
                 deque_.pop_back();
+                UTHREADPOOL_TRACE(wsq_steal, task.getTraceId(), deque_.size());
+                size = updateSize();
+                low = watermark_.checkLow(size);
                 result = true;
             }
             lock_.unlock();
         }
 
+        afterPop(result, low, size);
         return result;
     }
 
@@ -103,26 +224,96 @@ public:
      */
     CBool trySteal(UTaskArrRef taskArr, int maxStealBatchSize) {
         bool result = false;
+        CBool low = false;
+        CSize size = 0;
         if (lock_.tryLock()) {
             while (!deque_.empty() && maxStealBatchSize--) {
                 taskArr.emplace_back(std::move(deque_.back()));
                 deque_.pop_back();
+                UTHREADPOOL_TRACE(wsq_steal, taskArr.back().getTraceId(), deque_.size());
                 result = true;
             }
+            size = updateSize();
+            low = result && watermark_.checkLow(size);
             lock_.unlock();
         }
+
+        afterPop(result, low, size);
         return result;    // 如果非空，表示盗取成功
     }
 
+
+    /**
+     * 设置容量，为0表示不限制。需要在队列使用前设置
+     * @param capacity
+     * @return
+     */
+    UWorkStealingQueue* setCapacity(CSize capacity) {
+        capacity_ = capacity;
+        return this;
+    }
+
+
+    /**
+     * 设置高低水位信息。需要在队列使用前设置
+     * @return
+     */
+    UWorkStealingQueue* setWatermark(CIndex index, CSize high, CSize low,
+                                     const UWatermarkCallback& onHigh,
+                                     const UWatermarkCallback& onLow) {
+        watermark_.setWatermark(index, high, low, onHigh, onLow);
+        return this;
+    }
+
+
+    /**
+     * 获取队列的近似长度，不加锁
+     * @return
+     */
+    [[nodiscard]] CSize size() const {
+        return size_.load(std::memory_order_relaxed);
+    }
+
     UWorkStealingQueue() = default;
 
     NO_ALLOWED_COPY(UWorkStealingQueue)
 
 private:
-    std::deque<UTask> deque_;        // 存放任务的双向队列
+    /**
+     * 弹出或窃取之后调用，唤醒等待写入的线程，并通知低水位
+     * @param result 是否取出了任务
+     * @param low
+     * @param size
+     */
+    CVoid afterPop(CBool result, CBool low, CSize size) {
+        if (result && push_waiters_.load(std::memory_order_seq_cst) > 0) {
+            LOCK_GUARD lk(mutex_);    // 加锁后通知，避免等待方重试失败后、挂起前丢失通知
+            not_full_cv_.notify_all();
+        }
+        if (low) {
+            watermark_.notify(false, size);
+        }
+    }
+
+    /**
+     * 更新近似长度，需要在锁内调用
+     * @return
+     */
+    CSize updateSize() {
+        CSize size = deque_.size();
+        size_.store(size, std::memory_order_relaxed);
+        return size;
+    }
+
+private:
+    std::deque<UTask, UArenaAllocator<UTask>> deque_;    // 存放任务的双向队列，节点内存来自arena
     USpinLock lock_;                 // 用自旋锁处理
-    std::mutex mutex_;
-    std::condition_variable cv_;
+    std::atomic<CSize> size_ {0};    // 队列的近似长度，供无锁读取
+    CSize capacity_ = 0;             // 队列容量，为0表示不限制
+    UQueueWatermark watermark_;      // 高低水位信息
+    std::mutex mutex_;               // 仅用于等待写入
+    std::condition_variable not_full_cv_;    // 队列未满的条件变量，仅在有限容量时使用
+    std::atomic<CInt> push_waiters_ {0};     // 等待写入的线程数
 };
 
 
@@ -0,0 +1,414 @@
+/***************************
+@File: UReactor.h
+@Desc: 基于epoll的事件反应器，没有单独的线程，由空闲的主线程轮询
+       就绪的事件被封装成任务，放入轮询线程自己的队列中执行
+       仅支持linux系统
+***************************/
+
+#ifndef UREACTOR_H
+#define UREACTOR_H
+
+#include <map>
+#include <mutex>
+#include <functional>
+
+#ifdef __linux__
+#include <cerrno>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#endif
+
+#include "../ThreadPoolinc.hpp"
+#include "../CFuncType.hpp"
+#include "../UtilsDefine.hpp"
+#include "../Task/UTask.hpp"
+
+using UReactorCallback = std::function<CVoid(int, CUint)>;       // 参数为fd和就绪的事件
+using UIoCallback = std::function<CVoid(CLong)>;                 // 参数为读写的字节数，失败时为 -errno
+
+#ifdef __linux__
+
+class UReactor {
+    static const int MAX_POLL_EVENTS = 64;                       // 单次轮询最多处理的事件个数
+
+    struct UIoOperation {
+        CBool active_ = false;
+        void* buffer_ = nullptr;
+        CSize size_ = 0;
+        UIoCallback callback_ = nullptr;
+    };
+
+    struct UReactorHandler {
+        CUint events_ = 0;                                       // 持续监听的事件，为0表示没有持续监听
+        UReactorCallback callback_ = nullptr;
+        CBool in_flight_ = false;                                // 持续监听的回调是否正在执行，执行期间不再监听 events_
+        CULong watch_id_ = 0;                                    // 持续监听的版本号，防止 remove/add 之后旧回调恢复监听
+        UIoOperation read_;                                      // 一次性的异步读
+        UIoOperation write_;                                     // 一次性的异步写
+        DEFAULT_FUNCTION timer_ = nullptr;                       // 定时任务，fd为timerfd
+        CBool periodic_ = false;
+        CUint timer_gen_ = 0;                                    // 定时任务的版本号，防止fd复用后误取消
+    };
+
+public:
+    explicit UReactor() = default;
+
+    ~UReactor() {
+        destroy();
+    }
+
+    CStatus init() {
+        FUNCTION_BEGIN
+        LOCK_GUARD lk(mutex_);
+        if (epoll_fd_ >= 0) {
+            FUNCTION_END
+        }
+
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) {
+            RETURN_ERROR_STATUS("epoll create failed")
+        }
+        FUNCTION_END
+    }
+
+    /**
+     * 关闭epoll以及所有的timerfd，未完成的异步读写直接丢弃
+     * @return
+     */
+    CStatus destroy() {
+        FUNCTION_BEGIN
+        std::lock(poll_mutex_, mutex_);
+        LOCK_GUARD pollLock(poll_mutex_, std::adopt_lock);
+        LOCK_GUARD lk(mutex_, std::adopt_lock);
+        for (auto& cur : handlers_) {
+            if (cur.second.timer_) {
+                close(cur.first);
+            }
+        }
+        handlers_.clear();
+        if (epoll_fd_ >= 0) {
+            close(epoll_fd_);
+            epoll_fd_ = -1;
+        }
+        FUNCTION_END
+    }
+
+    /**
+     * 持续监听fd上的事件（水平触发），直到调用 remove()
+     * 同一个fd同时最多只有一个回调在执行：事件就绪后暂停监听，回调执行完成后恢复
+     * 因此回调中需要读完（或写完）数据，未处理完的数据会在恢复监听后再次触发
+     * @param fd
+     * @param events 如 EPOLLIN | EPOLLOUT
+     * @param callback 在线程池中执行
+     * @return
+     */
+    CStatus add(int fd, CUint events, const UReactorCallback& callback) {
+        FUNCTION_BEGIN
+        ASSERT_NOT_NULL(callback)
+        LOCK_GUARD lk(mutex_);
+        auto& handler = handlers_[fd];
+        handler.events_ = events;
+        handler.callback_ = callback;
+        handler.in_flight_ = false;
+        handler.watch_id_ = ++watch_seq_;
+        status = update(fd, handler);
+        FUNCTION_END
+    }
+
+    /**
+     * 取消fd上所有的监听，包括未完成的异步读写
+     * @param fd
+     * @return
+     */
+    CStatus remove(int fd) {
+        FUNCTION_BEGIN
+        LOCK_GUARD lk(mutex_);
+        auto cur = handlers_.find(fd);
+        if (cur == handlers_.end()) {
+            RETURN_ERROR_STATUS("fd is not registered")
+        }
+
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        handlers_.erase(cur);
+        FUNCTION_END
+    }
+
+    /**
+     * 异步读。fd可读时，在线程池中执行一次read，并将结果传入callback
+     * @param fd 需要为非阻塞模式
+     * @param buffer 在callback执行之前需要保持有效
+     * @param size
+     * @param callback
+     * @return
+     */
+    CStatus asyncRead(int fd, void* buffer, CSize size, const UIoCallback& callback) {
+        return submitIo(fd, buffer, size, callback, true);
+    }
+
+    /**
+     * 异步写。fd可写时，在线程池中执行一次write，并将结果传入callback
+     * @param fd 需要为非阻塞模式
+     * @param buffer 在callback执行之前需要保持有效
+     * @param size
+     * @param callback
+     * @return
+     */
+    CStatus asyncWrite(int fd, const void* buffer, CSize size, const UIoCallback& callback) {
+        return submitIo(fd, const_cast<void *>(buffer), size, callback, false);
+    }
+
+    /**
+     * 添加定时任务，基于timerfd实现
+     * @param func
+     * @param delay 单位为ms
+     * @param interval 为0表示仅执行一次，单位为ms
+     * @return 定时任务id，由版本号和timerfd组成，失败返回-1
+     */
+    CLong addTimer(DEFAULT_CONST_FUNCTION_REF func, CMSec delay, CMSec interval = 0) {
+        if (!func || delay < 0 || interval < 0) {
+            return -1;
+        }
+
+        int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (fd < 0) {
+            return -1;
+        }
+
+        delay = std::max(delay, 1);    // 全0表示停止定时器
+        itimerspec spec {};
+        spec.it_value.tv_sec = delay / 1000;
+        spec.it_value.tv_nsec = (long)(delay % 1000) * 1000000;
+        spec.it_interval.tv_sec = interval / 1000;
+        spec.it_interval.tv_nsec = (long)(interval % 1000) * 1000000;
+        timerfd_settime(fd, 0, &spec, nullptr);
+
+        LOCK_GUARD lk(mutex_);
+        auto& handler = handlers_[fd];
+        handler.timer_ = func;
+        handler.periodic_ = interval > 0;
+        handler.timer_gen_ = (++timer_gen_seq_) & 0x7FFFFFFF;    // 保证id为正数
+        if (update(fd, handler).isErr()) {
+            handlers_.erase(fd);
+            close(fd);
+            return -1;
+        }
+        return ((CLong)handler.timer_gen_ << 32) | (CLong)fd;
+    }
+
+    /**
+     * 取消定时任务
+     * @param id
+     * @return
+     */
+    CStatus cancelTimer(CLong id) {
+        FUNCTION_BEGIN
+        int fd = (int)(id & 0xFFFFFFFF);
+        CUint gen = (CUint)(id >> 32);
+        LOCK_GUARD lk(mutex_);
+        auto cur = handlers_.find(fd);
+        if (id < 0 || cur == handlers_.end() || !cur->second.timer_ || cur->second.timer_gen_ != gen) {
+            RETURN_ERROR_STATUS("timer is not exist")    // 已执行完成的一次性定时任务，fd可能已被复用
+        }
+
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        handlers_.erase(cur);
+        FUNCTION_END
+    }
+
+    /**
+     * 非阻塞轮询，同一时刻仅有一个线程轮询，其他线程直接返回
+     * @param tasks 就绪事件对应的任务，追加到尾部
+     * @return 新增的任务个数
+     */
+    CSize tryPoll(UTaskArrRef tasks) {
+        UNIQUE_LOCK pollLock(poll_mutex_, std::try_to_lock);
+        if (!pollLock.owns_lock() || epoll_fd_ < 0) {
+            return 0;
+        }
+
+        epoll_event events[MAX_POLL_EVENTS];
+        int num = epoll_wait(epoll_fd_, events, MAX_POLL_EVENTS, 0);
+        if (num <= 0) {
+            return 0;
+        }
+
+        CSize before = tasks.size();
+        LOCK_GUARD lk(mutex_);
+        for (int i = 0; i < num; i++) {
+            dispatch(events[i].data.fd, events[i].events, tasks);
+        }
+        return tasks.size() - before;
+    }
+
+    NO_ALLOWED_COPY(UReactor)
+
+private:
+    CStatus submitIo(int fd, void* buffer, CSize size, const UIoCallback& callback, CBool read) {
+        FUNCTION_BEGIN
+        ASSERT_NOT_NULL(callback)
+        LOCK_GUARD lk(mutex_);
+        auto& handler = handlers_[fd];
+        auto& operation = read ? handler.read_ : handler.write_;
+        if (operation.active_) {
+            RETURN_ERROR_STATUS("io operation is in progress")
+        }
+
+        operation.active_ = true;
+        operation.buffer_ = buffer;
+        operation.size_ = size;
+        operation.callback_ = callback;
+        status = update(fd, handler);
+        if (status.isErr()) {
+            operation = UIoOperation();
+        }
+        FUNCTION_END
+    }
+
+    /**
+     * 根据handler中的信息，更新epoll中监听的事件，需要在mutex_内调用
+     * @param fd
+     * @param handler
+     * @return
+     */
+    CStatus update(int fd, UReactorHandler& handler) {
+        FUNCTION_BEGIN
+        CUint events = handler.in_flight_ ? 0 : handler.events_;
+        if (handler.read_.active_ || handler.timer_) {
+            events |= EPOLLIN;
+        }
+        if (handler.write_.active_) {
+            events |= EPOLLOUT;
+        }
+
+        if (0 == events) {
+            // 没有需要监听的事件时移出epoll，否则 EPOLLERR/EPOLLHUP 仍会持续触发
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+            FUNCTION_END
+        }
+
+        epoll_event event {};
+        event.events = events;
+        event.data.fd = fd;
+        if (0 != epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event)
+            && (ENOENT != errno || 0 != epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event))) {
+            RETURN_ERROR_STATUS("epoll ctl failed")
+        }
+        FUNCTION_END
+    }
+
+    /**
+     * 将就绪的事件封装成任务，需要在mutex_内调用
+     * 一次性的读写，在封装后立即取消监听，避免重复触发
+     * @param fd
+     * @param events
+     * @param tasks
+     */
+    CVoid dispatch(int fd, CUint events, UTaskArrRef tasks) {
+        auto cur = handlers_.find(fd);
+        if (cur == handlers_.end()) {
+            return;
+        }
+
+        auto& handler = cur->second;
+        if (handler.timer_) {
+            uint64_t expired = 0;
+            CLong ret = ::read(fd, &expired, sizeof(expired));    // 读取后才会清除就绪状态
+            if (ret > 0) {
+                tasks.emplace_back(UTask(DEFAULT_FUNCTION(handler.timer_)));
+            }
+            if (!handler.periodic_) {
+                epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+                close(fd);
+                handlers_.erase(cur);
+            }
+            return;
+        }
+
+        CUint failed = EPOLLERR | EPOLLHUP;
+        if (handler.callback_ && !handler.in_flight_ && (events & (handler.events_ | failed))) {
+            auto callback = handler.callback_;
+            CULong watchId = handler.watch_id_;
+            handler.in_flight_ = true;
+            tasks.emplace_back([this, callback, fd, events, watchId] {
+                callback(fd, events);
+                rearm(fd, watchId);
+            });
+        }
+        if (handler.read_.active_ && (events & (EPOLLIN | failed))) {
+            auto operation = std::move(handler.read_);
+            handler.read_ = UIoOperation();
+            tasks.emplace_back([operation, fd] {
+                CLong ret = ::read(fd, operation.buffer_, operation.size_);
+                operation.callback_(ret < 0 ? -errno : ret);
+            });
+        }
+        if (handler.write_.active_ && (events & (EPOLLOUT | failed))) {
+            auto operation = std::move(handler.write_);
+            handler.write_ = UIoOperation();
+            tasks.emplace_back([operation, fd] {
+                CLong ret = ::write(fd, operation.buffer_, operation.size_);
+                operation.callback_(ret < 0 ? -errno : ret);
+            });
+        }
+
+        if (!handler.callback_ && !handler.read_.active_ && !handler.write_.active_) {
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+            handlers_.erase(cur);
+        } else {
+            update(fd, handler);
+        }
+    }
+
+    /**
+     * 持续监听的回调执行完成后，恢复监听
+     * @param fd
+     * @param watchId 回调对应的版本号，期间被 remove() 或重新 add() 时不处理
+     */
+    CVoid rearm(int fd, CULong watchId) {
+        LOCK_GUARD lk(mutex_);
+        auto cur = handlers_.find(fd);
+        if (epoll_fd_ < 0 || cur == handlers_.end()
+            || !cur->second.in_flight_ || cur->second.watch_id_ != watchId) {
+            return;
+        }
+
+        cur->second.in_flight_ = false;
+        update(fd, cur->second);
+    }
+
+private:
+    int epoll_fd_ = -1;
+    CULong watch_seq_ = 0;                                       // 持续监听的版本号，仅在mutex_内修改
+    CUint timer_gen_seq_ = 0;                                    // 定时任务的版本号，仅在mutex_内修改
+    std::map<int, UReactorHandler> handlers_;                    // fd和对应的处理信息
+    std::mutex mutex_;                                           // 保护 handlers_
+    std::mutex poll_mutex_;                                      // 保证同一时刻仅有一个线程轮询
+};
+
+#else
+
+/**
+ * 非linux系统，不支持反应器功能
+ */
+class UReactor {
+public:
+    CStatus init() {
+        return CStatus("reactor is not supported");
+    }
+
+    CStatus destroy() {
+        EMPTY_FUNCTION
+    }
+
+    CSize tryPoll(UTaskArrRef) {
+        return 0;
+    }
+};
+
+#endif
+
+using UReactorPtr = UReactor *;
+
+#endif //UREACTOR_H
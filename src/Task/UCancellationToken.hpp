@@ -0,0 +1,78 @@
+/***************************
+@File: UCancellationToken.h
+@Desc: 任务取消标记。同一个token可以被多个任务共享，
+       取消操作仅修改一个原子标记，与任务数量无关
+***************************/
+
+#ifndef UCANCELLATIONTOKEN_H
+#define UCANCELLATIONTOKEN_H
+
+#include <atomic>
+#include <future>
+#include <memory>
+
+#include "../ThreadPoolinc.hpp"
+#include "./UFutureTask.hpp"
+
+class UCancellationToken {
+public:
+    explicit UCancellationToken()
+        : state_(std::make_shared<std::atomic<CBool>>(false)) {}
+
+    /**
+     * 取消所有关联的任务
+     * 尚未执行的任务会被跳过，正在执行的任务可以通过 isCancelled() 自行判断
+     */
+    CVoid cancel() {
+        state_->store(true, std::memory_order_release);
+    }
+
+    /**
+     * 判断是否已经被取消
+     * @return
+     */
+    [[nodiscard]] CBool isCancelled() const {
+        return state_->load(std::memory_order_acquire);
+    }
+
+private:
+    std::shared_ptr<std::atomic<CBool>> state_;                  // 共享的取消标记
+};
+
+using UCancellationTokenRef = UCancellationToken &;
+
+
+/**
+ * 带取消标记的任务。出队执行时，若已被取消，则不执行原函数，
+ * 并向future中写入 CException("task is cancelled")
+ * @tparam FunctionType
+ * @tparam ResultType
+ */
+template<typename FunctionType, typename ResultType>
+class UCancellableTask {
+public:
+    explicit UCancellableTask(const FunctionType& func,
+                              const UCancellationToken& token)
+        : task_(func), token_(token) {}
+
+    UCancellableTask(UCancellableTask&& task) noexcept = default;
+
+    std::future<ResultType> getFuture() {
+        return task_.getFuture();
+    }
+
+    CVoid operator()() {
+        if (token_.isCancelled()) {
+            task_.setException(std::make_exception_ptr(CException("task is cancelled")));
+            return;
+        }
+
+        task_();
+    }
+
+private:
+    UFutureTask<FunctionType, ResultType> task_;                 // 原始任务
+    UCancellationToken token_;                                   // 取消标记
+};
+
+#endif //UCANCELLATIONTOKEN_H
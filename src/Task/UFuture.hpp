@@ -0,0 +1,391 @@
+/***************************
+@File: UFuture.h
+@Desc: 线程池的future。除阻塞等待外，还可以通过 then() 注册后续任务，
+       结果就绪时由完成任务的线程直接调度，不需要任何线程阻塞等待
+***************************/
+
+#ifndef UFUTURE_H
+#define UFUTURE_H
+
+#include <future>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+#include <type_traits>
+
+#include "../ThreadPoolinc.hpp"
+#include "../UtilsDefine.hpp"
+
+class UThreadPool;
+
+/**
+ * 结果的存储空间，不要求结果类型可以默认构造
+ * @tparam T
+ */
+template<typename T>
+class UFutureStorage {
+public:
+    explicit UFutureStorage() = default;
+
+    ~UFutureStorage() {
+        if (has_value_) {
+            ptr()->~T();
+        }
+    }
+
+    template<typename... Args>
+    CVoid set(Args&&... args) {
+        new (&data_) T(std::forward<Args>(args)...);
+        has_value_ = true;
+    }
+
+    T take() {
+        return std::move(*ptr());
+    }
+
+    NO_ALLOWED_COPY(UFutureStorage)
+
+private:
+    T* ptr() {
+        return reinterpret_cast<T *>(&data_);
+    }
+
+private:
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type data_;
+    CBool has_value_ = false;
+};
+
+
+template<>
+class UFutureStorage<CVoid> {
+public:
+    CVoid set() {}
+    CVoid take() {}
+};
+
+
+/**
+ * 共享状态。结果写入后，依次执行注册的回调，回调在写入结果的线程中执行
+ * @tparam T
+ */
+template<typename T>
+class UFutureState {
+public:
+    explicit UFutureState() = default;
+
+    template<typename... Args>
+    CVoid setValue(Args&&... args) {
+        complete([&] { storage_.set(std::forward<Args>(args)...); });
+    }
+
+    CVoid setException(std::exception_ptr ptr) {
+        complete([&] { exception_ = ptr; });
+    }
+
+    /**
+     * 注册结果就绪时的回调。已经就绪时，在当前线程中直接执行
+     * @param callback
+     */
+    CVoid onReady(std::function<CVoid()>&& callback) {
+        {
+            LOCK_GUARD lock(mutex_);
+            if (!ready_.load(std::memory_order_relaxed)) {
+                callbacks_.emplace_back(std::move(callback));
+                return;
+            }
+        }
+        callback();
+    }
+
+    CBool isReady() const {
+        return ready_.load(std::memory_order_acquire);
+    }
+
+    CVoid wait() {
+        UNIQUE_LOCK lock(mutex_);
+        cv_.wait(lock, [this] { return ready_.load(std::memory_order_relaxed); });
+    }
+
+    /**
+     * 等待结果，并取出结果或抛出异常。仅可调用一次
+     * @return
+     */
+    T take() {
+        wait();
+        if (exception_) {
+            std::rethrow_exception(exception_);
+        }
+        return storage_.take();
+    }
+
+    std::exception_ptr getException() const {
+        return exception_;
+    }
+
+    NO_ALLOWED_COPY(UFutureState)
+
+private:
+    template<typename SetFunc>
+    CVoid complete(const SetFunc& setFunc) {
+        std::vector<std::function<CVoid()>> callbacks;
+        {
+            LOCK_GUARD lock(mutex_);
+            if (ready_.load(std::memory_order_relaxed)) {
+                return;    // 重复写入时忽略
+            }
+            setFunc();
+            ready_.store(true, std::memory_order_release);
+            callbacks.swap(callbacks_);
+        }
+        cv_.notify_all();
+
+        for (auto& callback : callbacks) {
+            callback();
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::atomic<CBool> ready_ { false };                         // 结果或异常是否已写入
+    UFutureStorage<T> storage_;                                  // 结果信息
+    std::exception_ptr exception_ = nullptr;                     // 异常信息
+    std::vector<std::function<CVoid()>> callbacks_;              // 就绪时执行的回调
+};
+
+
+/**
+ * 与 UPromise 配对使用，结果只能被取出一次
+ * @tparam T
+ */
+template<typename T>
+class UFuture {
+    template<typename FunctionType, typename InputType, typename = CVoid>
+    struct UThenResult {
+        using type = typename std::result_of<FunctionType(InputType)>::type;
+    };
+
+    template<typename FunctionType, typename InputType>
+    struct UThenResult<FunctionType, InputType, typename std::enable_if<std::is_void<InputType>::value>::type> {
+        using type = typename std::result_of<FunctionType()>::type;
+    };
+
+public:
+    explicit UFuture() = default;
+
+    explicit UFuture(std::shared_ptr<UFutureState<T>> state,
+                     UThreadPool* pool)
+        : state_(std::move(state)), pool_(pool) {}
+
+    UFuture(UFuture&& future) noexcept = default;
+    UFuture& operator=(UFuture&& future) noexcept = default;
+
+    /**
+     * 是否关联了共享状态。get() 和 then() 之后不再关联
+     * @return
+     */
+    [[nodiscard]] CBool valid() const {
+        return nullptr != state_;
+    }
+
+    /**
+     * 结果是否已经就绪，不阻塞
+     * @return
+     */
+    [[nodiscard]] CBool isReady() const {
+        return nullptr != state_ && state_->isReady();
+    }
+
+    CVoid wait() const {
+        state_->wait();
+    }
+
+    /**
+     * 阻塞等待并取出结果，任务抛出的异常在此处重新抛出
+     * @return
+     */
+    T get() {
+        auto state = std::move(state_);
+        return state->take();
+    }
+
+    /**
+     * 注册后续任务，结果就绪后以结果作为参数执行。执行后，当前future不再有效
+     * 前序任务抛出异常时，不执行func，异常直接传递给返回的future
+     * @tparam FunctionType 参数为T，T为void时没有参数
+     * @param func
+     * @param inlineRun 为true时，在完成前序任务的线程中直接执行，适用于很小的任务
+     *                  否则放入完成线程的本地队列中，由线程池调度
+     * @return
+     */
+    template<typename FunctionType>
+    auto then(const FunctionType& func,
+              CBool inlineRun = false)
+    -> UFuture<typename UThenResult<FunctionType, T>::type>;
+
+    NO_ALLOWED_COPY(UFuture)
+
+private:
+    /**
+     * 注册就绪回调，不取出结果。供 whenAll/whenAny 使用
+     * @param callback
+     */
+    CVoid onReady(std::function<CVoid()>&& callback) {
+        state_->onReady(std::move(callback));
+    }
+
+private:
+    std::shared_ptr<UFutureState<T>> state_ = nullptr;           // 共享状态
+    UThreadPool* pool_ = nullptr;                                // 执行后续任务的线程池
+
+    template<typename U> friend class UFuture;
+    friend class UThreadPool;
+};
+
+
+/**
+ * 写入结果的一方。析构时仍未写入结果，则写入 broken_promise 异常
+ * @tparam T
+ */
+template<typename T>
+class UPromise {
+public:
+    explicit UPromise()
+        : state_(std::make_shared<UFutureState<T>>()) {}
+
+    UPromise(UPromise&& promise) noexcept = default;
+
+    ~UPromise() {
+        if (nullptr != state_ && !state_->isReady()) {
+            state_->setException(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+        }
+    }
+
+    UFuture<T> getFuture(UThreadPool* pool) {
+        return UFuture<T>(state_, pool);
+    }
+
+    template<typename... Args>
+    CVoid setValue(Args&&... args) {
+        state_->setValue(std::forward<Args>(args)...);
+    }
+
+    CVoid setException(std::exception_ptr ptr) {
+        state_->setException(ptr);
+    }
+
+    NO_ALLOWED_COPY(UPromise)
+
+private:
+    std::shared_ptr<UFutureState<T>> state_;
+};
+
+
+/**
+ * 执行函数并将结果写入 UPromise 的任务，与 UFutureTask 对应
+ * @tparam FunctionType
+ * @tparam ResultType
+ */
+template<typename FunctionType, typename ResultType>
+class UPromiseTask {
+public:
+    explicit UPromiseTask(const FunctionType& func)
+        : func_(func) {}
+
+    UPromiseTask(UPromiseTask&& task) noexcept = default;
+
+    UFuture<ResultType> getFuture(UThreadPool* pool) {
+        return promise_.getFuture(pool);
+    }
+
+    CVoid operator()() {
+        try {
+            setValue(std::is_void<ResultType>());
+        } catch (...) {
+            promise_.setException(std::current_exception());
+        }
+    }
+
+private:
+    CVoid setValue(std::true_type) {
+        func_();
+        promise_.setValue();
+    }
+
+    CVoid setValue(std::false_type) {
+        promise_.setValue(func_());
+    }
+
+private:
+    FunctionType func_;                                          // 原始任务
+    UPromise<ResultType> promise_;
+};
+
+
+/**
+ * 后续任务，前序结果就绪后执行，结果写入新的 UPromise
+ * @tparam FunctionType
+ * @tparam InputType 前序任务的结果类型
+ * @tparam ResultType
+ */
+template<typename FunctionType, typename InputType, typename ResultType>
+class UContinuationTask {
+public:
+    explicit UContinuationTask(std::shared_ptr<UFutureState<InputType>> input,
+                               std::shared_ptr<UPromise<ResultType>> promise,
+                               const FunctionType& func)
+        : input_(std::move(input)), promise_(std::move(promise)), func_(func) {}
+
+    CVoid operator()() {
+        if (input_->getException()) {
+            promise_->setException(input_->getException());
+            return;
+        }
+
+        try {
+            setValue(std::is_void<InputType>(), std::is_void<ResultType>());
+        } catch (...) {
+            promise_->setException(std::current_exception());
+        }
+    }
+
+private:
+    CVoid setValue(std::true_type, std::true_type) {
+        func_();
+        promise_->setValue();
+    }
+
+    CVoid setValue(std::true_type, std::false_type) {
+        promise_->setValue(func_());
+    }
+
+    CVoid setValue(std::false_type, std::true_type) {
+        func_(input_->take());
+        promise_->setValue();
+    }
+
+    CVoid setValue(std::false_type, std::false_type) {
+        promise_->setValue(func_(input_->take()));
+    }
+
+private:
+    std::shared_ptr<UFutureState<InputType>> input_;             // 前序任务的共享状态
+    std::shared_ptr<UPromise<ResultType>> promise_;              // 后续任务的结果
+    FunctionType func_;
+};
+
+
+/**
+ * whenAny 的结果
+ * @tparam T
+ */
+template<typename T>
+struct UWhenAnyResult {
+    CSize index_ = 0;                                            // 最先就绪的future的下标
+    std::vector<UFuture<T>> futures_;                            // 传入的所有future，顺序不变
+};
+
+#endif //UFUTURE_H
@@ -0,0 +1,60 @@
+/***************************
+@File: UFutureTask.h
+@Desc: 带返回值的任务。与packaged_task功能一致，
+       但future的共享状态从线程级arena中申请
+***************************/
+
+#ifndef UFUTURETASK_H
+#define UFUTURETASK_H
+
+#include <future>
+#include <memory>
+#include <type_traits>
+
+#include "../ThreadPoolinc.hpp"
+#include "../UAllocator.hpp"
+
+template<typename FunctionType, typename ResultType>
+class UFutureTask {
+public:
+    explicit UFutureTask(const FunctionType& func)
+        : func_(func), promise_(std::allocator_arg, UArenaAllocator<ResultType>()) {}
+
+    UFutureTask(UFutureTask&& task) noexcept = default;
+
+    std::future<ResultType> getFuture() {
+        return promise_.get_future();
+    }
+
+    CVoid operator()() {
+        try {
+            setValue(std::is_void<ResultType>());
+        } catch (...) {
+            promise_.set_exception(std::current_exception());
+        }
+    }
+
+    /**
+     * 不执行原函数，直接写入异常信息
+     * @param ptr
+     */
+    CVoid setException(std::exception_ptr ptr) {
+        promise_.set_exception(ptr);
+    }
+
+private:
+    CVoid setValue(std::true_type) {
+        func_();
+        promise_.set_value();
+    }
+
+    CVoid setValue(std::false_type) {
+        promise_.set_value(func_());
+    }
+
+private:
+    FunctionType func_;                                          // 原始任务
+    std::promise<ResultType> promise_;                           // 共享状态来自arena
+};
+
+#endif //UFUTURETASK_H
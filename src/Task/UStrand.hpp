@@ -0,0 +1,191 @@
+/***************************
+@File: UStrand.h
+@Desc: 串行执行器。同一个strand中的任务按照写入顺序，逐个执行
+       仅在有任务时被调度到线程池中，不会阻塞工作线程
+       每个key对应一个strand，由 UStrandMap 在第一次写入时创建，任务全部执行完成后释放
+***************************/
+
+#ifndef USTRAND_H
+#define USTRAND_H
+
+#include <mutex>
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <functional>
+
+#include "../ThreadPoolinc.hpp"
+#include "../UtilsDefine.hpp"
+#include "../Queue/UMpscQueue.hpp"
+#include "./UTask.hpp"
+
+class UStrand {
+public:
+    explicit UStrand() = default;
+
+    /**
+     * 写入任务，调用方需要持有strand所在分片的锁
+     * @param task
+     * @return 是否由空变为非空。为true时，需要调用方将strand调度到线程池中
+     */
+    CBool push(UTask&& task) {
+        queue_.push(std::move(task));
+        return 0 == pending_++;
+    }
+
+    /**
+     * 依次执行任务，同一时刻仅允许一个线程调用，不需要加锁
+     * @tparam RunFunc 参数为 UTask&
+     * @param maxSize 本次最多执行的任务个数
+     * @param run 执行单个任务，由线程池提供，负责钩子、统计等
+     * @return 本次执行的任务个数，需要通过 finish() 扣除
+     */
+    template<typename RunFunc>
+    CSize drain(CSize maxSize, const RunFunc& run) {
+        CSize size = 0;
+        UTask task;
+        while (size < maxSize && queue_.tryPop(task)) {
+            run(task);
+            size++;
+        }
+        return size;
+    }
+
+    /**
+     * 扣除已执行的任务个数，调用方需要持有strand所在分片的锁
+     * @param size
+     * @return 剩余的任务个数。大于0时，需要调用方重新调度
+     */
+    CSize finish(CSize size) {
+        pending_ -= size;
+        return pending_;
+    }
+
+    /**
+     * 丢弃所有未执行的任务，future中返回 broken_promise。仅在没有线程执行 drain() 时调用
+     * @return 丢弃的任务个数
+     */
+    CSize clear() {
+        UTask task;
+        while (queue_.tryPop(task)) {
+        }
+
+        CSize size = pending_;
+        pending_ = 0;
+        return size;
+    }
+
+    NO_ALLOWED_COPY(UStrand)
+
+private:
+    UMpscQueue<UTask> queue_;                                    // 待执行的任务
+    CSize pending_ = 0;                                          // 已写入未执行的任务个数，为0表示未被调度。由分片的锁保护
+};
+
+using UStrandPtr = std::shared_ptr<UStrand>;
+
+
+/**
+ * strand的容器，与key的类型无关的部分，供线程池统一调度和清理
+ */
+class UStrandMapBase {
+public:
+    virtual ~UStrandMapBase() = default;
+
+    /**
+     * strand执行完一批任务后调用。没有剩余任务时，将其从容器中移除，由最后一个持有方释放
+     * @param strand
+     * @param size 本次执行的任务个数
+     * @return 剩余的任务个数
+     */
+    virtual CSize finish(const UStrandPtr& strand, CSize size) = 0;
+
+    /**
+     * 丢弃所有strand及其中未执行的任务。仅在没有线程执行 drain() 时调用
+     * @return 丢弃的任务个数
+     */
+    virtual CSize clear() = 0;
+};
+
+using UStrandMapBasePtr = UStrandMapBase *;
+
+
+/**
+ * 按key保存strand。分片加锁，仅在写入和执行完一批任务时加锁，执行任务时不加锁
+ * 只保存有未执行任务的strand，空闲的key不占用内存，因此key的个数不受限制
+ * @tparam KeyType 需要支持 std::hash 和 operator==
+ */
+template<typename KeyType>
+class UStrandMap : public UStrandMapBase {
+    class UKeyedStrand : public UStrand {
+    public:
+        explicit UKeyedStrand(const KeyType& key, CSize shard) : key_(key), shard_(shard) {}
+
+        KeyType key_;                                            // 所属的key，移除时使用
+        CSize shard_ = 0;                                        // 所在的分片
+    };
+
+    struct UStrandShard {
+        std::mutex mutex_;
+        std::unordered_map<KeyType, std::shared_ptr<UKeyedStrand>> strands_;
+    };
+
+public:
+    explicit UStrandMap(CSize shardSize)
+        : shard_size_(std::max<CSize>(shardSize, 1)),
+          shards_(new UStrandShard[std::max<CSize>(shardSize, 1)]) {}
+
+    /**
+     * 写入key对应的strand，不存在时创建
+     * @param key
+     * @param task
+     * @return strand由空变为非空时返回该strand，需要调用方调度；否则返回nullptr
+     */
+    UStrandPtr push(const KeyType& key, UTask&& task) {
+        // 打散hash值，避免整数key的低位规律集中到少数分片上
+        CSize hash = (CSize)std::hash<KeyType>{}(key);
+        CSize index = (CSize)(((unsigned long long)hash * 0x9E3779B97F4A7C15ULL) >> 32) % shard_size_;
+        auto& shard = shards_[index];
+        LOCK_GUARD lk(shard.mutex_);
+        auto& strand = shard.strands_[key];
+        if (nullptr == strand) {
+            strand = std::make_shared<UKeyedStrand>(key, index);
+        }
+        return strand->push(std::move(task)) ? strand : nullptr;
+    }
+
+    CSize finish(const UStrandPtr& strand, CSize size) override {
+        auto keyed = static_cast<UKeyedStrand *>(strand.get());
+        auto& shard = shards_[keyed->shard_];
+        LOCK_GUARD lk(shard.mutex_);
+        CSize left = keyed->finish(size);
+        if (0 == left) {
+            // 已被 clear() 移除时，相同key可能已经有了新的strand，不能误删
+            auto result = shard.strands_.find(keyed->key_);
+            if (result != shard.strands_.end() && result->second.get() == keyed) {
+                shard.strands_.erase(result);
+            }
+        }
+        return left;
+    }
+
+    CSize clear() override {
+        CSize size = 0;
+        for (CSize i = 0; i < shard_size_; i++) {
+            LOCK_GUARD lk(shards_[i].mutex_);
+            for (auto& cur : shards_[i].strands_) {
+                size += cur.second->clear();
+            }
+            shards_[i].strands_.clear();
+        }
+        return size;
+    }
+
+    NO_ALLOWED_COPY(UStrandMap)
+
+private:
+    CSize shard_size_ = 1;                                       // 分片个数
+    std::unique_ptr<UStrandShard[]> shards_;                     // 分片信息
+};
+
+#endif //USTRAND_H
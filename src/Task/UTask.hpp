@@ -10,12 +10,26 @@
 #include <type_traits>
 #include <vector>
 #include "../ThreadPoolinc.hpp"
+#include "../UAllocator.hpp"
+#include "./UTaskHooks.hpp"
+#include "./UTaskLabel.hpp"
 
 class UTask {
     struct taskBased {
         explicit taskBased() = default;
         virtual CVoid call() = 0;
         virtual ~taskBased() = default;
+
+        CUint label_ = UTaskLabel::current();  // 创建时所在线程的标签，放在任务实体中，不增加UTask的大小
+
+        // 任务实体从线程级arena中申请，避免频繁malloc
+        static void* operator new(CSize size) {
+            return UAllocator::arenaMalloc(size);
+        }
+
+        static CVoid operator delete(void* ptr) {
+            UAllocator::arenaFree(ptr);
+        }
     };
 
     // 退化以获得实际类型，修改思路参考：https://github.com/ChunelFeng/CThreadPool/pull/3
@@ -36,14 +50,42 @@ class UTask {
     UTask() = default;
 
     UTask(UTask&& task) noexcept
-        : impl_(std::move(task.impl_)), priority_(task.priority_) {}
+        : impl_(std::move(task.impl_)), priority_(task.priority_), hook_context_(task.hook_context_) {}
+
+    UTask(UTask&& task, int priority) noexcept
+        : impl_(std::move(task.impl_)), priority_(priority), hook_context_(task.hook_context_) {}
 
     UTask& operator=(UTask&& task) noexcept {
         impl_ = std::move(task.impl_);
         priority_ = task.priority_;
+        hook_context_ = task.hook_context_;
         return *this;
     }
 
+    /**
+     * 获取钩子使用的上下文信息，类型由钩子策略决定
+     * @return
+     */
+    UTaskHooks::ContextType& getHookContext() {
+        return hook_context_;
+    }
+
+    /**
+     * 获取任务的标签id，0表示不带标签
+     * @return
+     */
+    [[nodiscard]] CUint getLabel() const {
+        return nullptr != impl_ ? impl_->label_ : 0;
+    }
+
+    /**
+     * 获取任务在探针中的id，即任务实体的地址，移动前后保持不变
+     * @return
+     */
+    [[nodiscard]] const CVoid* getTraceId() const {
+        return impl_.get();
+    }
+
     CBool operator>(const UTask& task) const {
         return priority_ < task.priority_;  // 新加入的，放到后面
     }
@@ -57,6 +99,7 @@ class UTask {
    private:
     std::unique_ptr<taskBased> impl_ = nullptr;
     int priority_ = 0;  // 任务的优先级信息
+    UTaskHooks::ContextType hook_context_ {};  // 钩子的上下文，默认策略下为空类型
 };
 
 using UTaskRef = UTask&;
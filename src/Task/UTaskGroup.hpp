@@ -10,7 +10,9 @@
 
 #include "../ThreadPoolinc.hpp"
 #include "./UTask.hpp"
+#include "./UCancellationToken.hpp"
 #include "../CFuncType.hpp"
+#include "../CStdEx.hpp"
 
 class UTaskGroup {
 public:
@@ -59,6 +61,16 @@ public:
         return this;
     }
 
+    /**
+     * 设置取消标记，组内所有任务共享。取消后，尚未执行的任务会被跳过
+     * @param token
+     * @return
+     */
+    UTaskGroup* setCancellationToken(const UCancellationToken& token) {
+        this->token_ = c_make_unique<UCancellationToken>(token);
+        return this;
+    }
+
     /**
      * 获取最大超时时间信息
      * @return
@@ -87,6 +99,7 @@ private:
     std::vector<DEFAULT_FUNCTION> task_arr_;         // 任务消息
     CMSec ttl_ = MAX_BLOCK_TTL;                      // 任务组最大执行耗时(如果是0的话，则表示不阻塞)
     CALLBACK_FUNCTION on_finished_ = nullptr;        // 执行函数任务结束
+    std::unique_ptr<UCancellationToken> token_;      // 取消标记，为空表示不可取消
 
     friend class UThreadPool;
 };
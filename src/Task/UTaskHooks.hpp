@@ -0,0 +1,112 @@
+/***************************
+@File: UTaskHooks.h
+@Desc: 任务生命周期钩子，在编译期通过 _UTHREADPOOL_TASK_HOOKS_ 宏选择策略
+       默认的空策略不会产生任何额外开销；URuntimeTaskHooks 支持在运行时注册
+       每个任务携带一份 ContextType，可以在写入时记录上下文（如trace id），执行时恢复
+***************************/
+
+#ifndef UTASKHOOKS_H
+#define UTASKHOOKS_H
+
+#include <atomic>
+
+#include "../ThreadPoolinc.hpp"
+
+/**
+ * 空策略，所有钩子均为空的内联函数，编译后不产生任何代码
+ * 自定义策略需要提供相同的类型和静态函数
+ */
+struct UEmptyTaskHooks {
+    struct ContextType {};                                       // 空类型，占用UTask中的对齐空间，不增加大小
+
+    static CVoid onEnqueue(ContextType&) {}                      // 任务写入线程池时，在提交线程中调用
+    static CVoid beforeRun(ContextType&) {}                      // 任务执行前，在执行线程中调用
+    static CVoid afterRun(ContextType&) {}                       // 任务执行后，在执行线程中调用
+    static CVoid onSteal(CIndex, CSize) {}                       // 窃取成功时调用，参数为被窃取的主线程index和任务个数
+    static CVoid onIdle(CIndex) {}                               // 没有获取到任务时调用，参数为线程index，辅助线程为-1
+};
+
+
+/**
+ * 运行时钩子的接口，按需重写
+ */
+class UTaskHooksInterface {
+public:
+    virtual ~UTaskHooksInterface() = default;
+
+    virtual CVoid onEnqueue(CULong& /* context */) {}
+    virtual CVoid beforeRun(CULong& /* context */) {}
+    virtual CVoid afterRun(CULong& /* context */) {}
+    virtual CVoid onSteal(CIndex /* victim */, CSize /* size */) {}
+    virtual CVoid onIdle(CIndex /* index */) {}
+};
+
+
+/**
+ * 运行时策略。未注册时，每个钩子仅多一次原子读取
+ */
+struct URuntimeTaskHooks {
+    using ContextType = CULong;                                  // 可以存放id或指针
+
+    /**
+     * 注册钩子，传入nullptr表示取消。需要保证在线程池使用期间有效
+     * @param hooks
+     */
+    static CVoid setHooks(UTaskHooksInterface* hooks) {
+        current().store(hooks, std::memory_order_release);
+    }
+
+    static CVoid onEnqueue(ContextType& context) {
+        auto hooks = current().load(std::memory_order_acquire);
+        if (nullptr != hooks) {
+            hooks->onEnqueue(context);
+        }
+    }
+
+    static CVoid beforeRun(ContextType& context) {
+        auto hooks = current().load(std::memory_order_acquire);
+        if (nullptr != hooks) {
+            hooks->beforeRun(context);
+        }
+    }
+
+    static CVoid afterRun(ContextType& context) {
+        auto hooks = current().load(std::memory_order_acquire);
+        if (nullptr != hooks) {
+            hooks->afterRun(context);
+        }
+    }
+
+    static CVoid onSteal(CIndex victim, CSize size) {
+        auto hooks = current().load(std::memory_order_acquire);
+        if (nullptr != hooks) {
+            hooks->onSteal(victim, size);
+        }
+    }
+
+    static CVoid onIdle(CIndex index) {
+        auto hooks = current().load(std::memory_order_acquire);
+        if (nullptr != hooks) {
+            hooks->onIdle(index);
+        }
+    }
+
+private:
+    static std::atomic<UTaskHooksInterface *>& current() {
+        static std::atomic<UTaskHooksInterface *> hooks { nullptr };
+        return hooks;
+    }
+};
+
+
+/**
+ * 定义该宏即可替换策略，如 -D_UTHREADPOOL_TASK_HOOKS_=URuntimeTaskHooks
+ * 需要在所有编译单元中保持一致，建议通过编译参数定义
+ */
+#ifndef _UTHREADPOOL_TASK_HOOKS_
+#define _UTHREADPOOL_TASK_HOOKS_ UEmptyTaskHooks
+#endif
+
+using UTaskHooks = _UTHREADPOOL_TASK_HOOKS_;
+
+#endif //UTASKHOOKS_H
@@ -0,0 +1,222 @@
+/***************************
+@File: UTaskLabel.h
+@Desc: 任务标签，用于按照业务或租户统计cpu耗时
+       标签名称在全局注册为整数id，任务创建时记录当前线程的标签，执行时自动继承给嵌套提交的任务
+       每个工作线程记录各自的统计表，查询时合并，记录时没有竞争
+***************************/
+
+#ifndef UTASKLABEL_H
+#define UTASKLABEL_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <ctime>
+#include <chrono>
+
+#include "../ThreadPoolinc.hpp"
+#include "../UtilsDefine.hpp"
+
+/**
+ * 单个标签的统计信息
+ */
+struct UTaskLabelReport {
+    std::string name_;                                           // 标签名称，未设置标签的任务为空
+    CULong task_num_ = 0;                                        // 执行的任务个数
+    CULong sampled_num_ = 0;                                     // 采样统计cpu耗时的任务个数
+    CULong cpu_ns_ = 0;                                          // 按照采样间隔折算后的cpu耗时，单位为ns
+};
+
+
+class UTaskLabel {
+    struct UTaskLabelStat {
+        std::atomic<CULong> task_num_ { 0 };
+        std::atomic<CULong> sampled_num_ { 0 };
+        std::atomic<CULong> cpu_ns_ { 0 };
+    };
+
+    /**
+     * 单个线程的统计表，仅由所属线程写入。线程退出后保留，由之后的线程继续使用
+     */
+    struct UTaskLabelTable {
+        std::atomic<CBool> in_use_ { false };
+        std::unique_ptr<UTaskLabelStat[]> stats_ { new UTaskLabelStat[MAX_TASK_LABEL_SIZE] };
+        CSize sample_cursor_ = 0;                                // 距离上次采样的任务个数
+    };
+
+    /**
+     * 线程退出时，归还统计表
+     */
+    struct UTaskLabelTableHolder {
+        UTaskLabelTable* table_ = nullptr;
+
+        ~UTaskLabelTableHolder() {
+            if (nullptr != table_) {
+                table_->in_use_.store(false, std::memory_order_release);
+            }
+        }
+    };
+
+public:
+    /**
+     * 作用域内提交的任务，都带有该标签。可以嵌套
+     */
+    class Scope {
+    public:
+        explicit Scope(const std::string& name)
+            : Scope(UTaskLabel::intern(name)) {}
+
+        explicit Scope(CUint id) : prev_(current()) {
+            current() = id;
+        }
+
+        ~Scope() {
+            current() = prev_;
+        }
+
+        NO_ALLOWED_COPY(Scope)
+
+    private:
+        CUint prev_ = 0;                                         // 进入作用域前的标签
+    };
+
+    /**
+     * 注册标签名称，相同名称返回相同的id
+     * @param name
+     * @return 超过 MAX_TASK_LABEL_SIZE 时返回0，即不带标签
+     */
+    static CUint intern(const std::string& name) {
+        auto& registry = getRegistry();
+        LOCK_GUARD lk(registry.mutex_);
+        auto result = registry.ids_.find(name);
+        if (result != registry.ids_.end()) {
+            return result->second;
+        }
+
+        if (registry.names_.size() >= MAX_TASK_LABEL_SIZE) {
+            return 0;
+        }
+        CUint id = (CUint)registry.names_.size();
+        registry.names_.emplace_back(name);
+        registry.ids_[name] = id;
+        return id;
+    }
+
+    /**
+     * 当前线程的标签，任务创建时读取
+     * @return
+     */
+    static CUint& current() {
+        static thread_local CUint label = 0;
+        return label;
+    }
+
+    /**
+     * 记录一次任务执行，仅在工作线程中调用
+     * @param id
+     * @param cpuNs 采样时的cpu耗时，未采样时为0
+     * @param samplePeriod 采样间隔，用于折算总耗时
+     */
+    static CVoid record(CUint id, CULong cpuNs, CBool sampled, CSize samplePeriod) {
+        auto& stat = localTable()->stats_[id];
+        stat.task_num_.store(stat.task_num_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (sampled) {
+            stat.sampled_num_.store(stat.sampled_num_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            stat.cpu_ns_.store(stat.cpu_ns_.load(std::memory_order_relaxed) + cpuNs * samplePeriod, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * 判断本次执行是否需要采样，每 samplePeriod 个任务采样一次
+     * @param samplePeriod
+     * @return
+     */
+    static CBool needSample(CSize samplePeriod) {
+        auto table = localTable();
+        if (++table->sample_cursor_ < samplePeriod) {
+            return false;
+        }
+        table->sample_cursor_ = 0;
+        return true;
+    }
+
+    /**
+     * 获取当前线程的cpu时间，单位为ns。不支持时使用单调时钟
+     * @return
+     */
+    static CULong getThreadCpuTime() {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+        timespec ts {};
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return (CULong)ts.tv_sec * 1000000000UL + (CULong)ts.tv_nsec;
+#else
+        return (CULong)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    /**
+     * 合并所有线程的统计表
+     * @return 仅包含执行过任务的标签
+     */
+    static std::vector<UTaskLabelReport> getReport() {
+        auto& registry = getRegistry();
+        LOCK_GUARD lk(registry.mutex_);
+        std::vector<UTaskLabelReport> reports;
+        for (CSize id = 0; id < registry.names_.size(); id++) {
+            UTaskLabelReport report;
+            report.name_ = registry.names_[id];
+            for (auto& table : registry.tables_) {
+                auto& stat = table->stats_[id];
+                report.task_num_ += stat.task_num_.load(std::memory_order_relaxed);
+                report.sampled_num_ += stat.sampled_num_.load(std::memory_order_relaxed);
+                report.cpu_ns_ += stat.cpu_ns_.load(std::memory_order_relaxed);
+            }
+            if (report.task_num_ > 0) {
+                reports.emplace_back(std::move(report));
+            }
+        }
+        return reports;
+    }
+
+private:
+    struct UTaskLabelRegistry {
+        std::mutex mutex_;
+        std::vector<std::string> names_ { "" };                  // 下标即为id，0表示不带标签
+        std::unordered_map<std::string, CUint> ids_ { {"", 0} };
+        std::vector<std::unique_ptr<UTaskLabelTable>> tables_;   // 所有线程的统计表，只增不减
+    };
+
+    static UTaskLabelRegistry& getRegistry() {
+        static UTaskLabelRegistry registry;
+        return registry;
+    }
+
+    static UTaskLabelTable* localTable() {
+        static thread_local UTaskLabelTableHolder holder;
+        if (nullptr == holder.table_) {
+            holder.table_ = acquireTable();
+        }
+        return holder.table_;
+    }
+
+    static UTaskLabelTable* acquireTable() {
+        auto& registry = getRegistry();
+        LOCK_GUARD lk(registry.mutex_);
+        for (auto& table : registry.tables_) {
+            CBool expected = false;
+            if (table->in_use_.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                return table.get();
+            }
+        }
+
+        registry.tables_.emplace_back(new UTaskLabelTable());
+        registry.tables_.back()->in_use_.store(true, std::memory_order_relaxed);
+        return registry.tables_.back().get();
+    }
+};
+
+#endif //UTASKLABEL_H
@@ -0,0 +1,97 @@
+/***************************
+@File: UIdleBitmap.h
+@Desc: 记录空闲的主线程，每个线程占一个bit
+       空闲线程自行置位，提交方通过原子清零来认领，保证同一次空闲仅被一个提交方认领
+***************************/
+
+#ifndef UIDLEBITMAP_H
+#define UIDLEBITMAP_H
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+#include "../ThreadPoolinc.hpp"
+
+class UIdleBitmap {
+    static const int WORD_BITS = 64;
+
+public:
+    explicit UIdleBitmap() = default;
+
+    /**
+     * 设置可记录的线程个数，需要在线程启动前调用
+     * @param size
+     */
+    CVoid init(int size) {
+        word_size_ = (size + WORD_BITS - 1) / WORD_BITS;
+        words_.reset(new std::atomic<uint64_t>[word_size_]);
+        for (int i = 0; i < word_size_; i++) {
+            words_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * 标记线程空闲
+     * @param index
+     */
+    CVoid set(int index) {
+        words_[index / WORD_BITS].fetch_or(mask(index), std::memory_order_release);
+    }
+
+    /**
+     * 标记线程忙碌
+     * @param index
+     */
+    CVoid reset(int index) {
+        words_[index / WORD_BITS].fetch_and(~mask(index), std::memory_order_relaxed);
+    }
+
+    /**
+     * 认领一个空闲的线程，认领后对应的bit被清零
+     * @param limit 仅认领 [0, limit) 范围内的线程
+     * @return 线程index，没有空闲线程时返回-1
+     */
+    int claim(int limit) {
+        for (int i = 0; i < word_size_ && i * WORD_BITS < limit; i++) {
+            uint64_t word = words_[i].load(std::memory_order_relaxed);
+            while (0 != word) {
+                int index = i * WORD_BITS + lowestBit(word);
+                if (index >= limit) {
+                    break;
+                }
+
+                if (words_[i].fetch_and(~mask(index), std::memory_order_acquire) & mask(index)) {
+                    return index;
+                }
+                word = words_[i].load(std::memory_order_relaxed);    // 被其他提交方抢先认领，重新查找
+            }
+        }
+        return -1;
+    }
+
+private:
+    static uint64_t mask(int index) {
+        return (uint64_t)1 << (index % WORD_BITS);
+    }
+
+    static int lowestBit(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(word);
+#else
+        int bit = 0;
+        while (0 == ((word >> bit) & 1)) {
+            bit++;
+        }
+        return bit;
+#endif
+    }
+
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> words_;
+    int word_size_ = 0;
+};
+
+using UIdleBitmapPtr = UIdleBitmap *;
+
+#endif //UIDLEBITMAP_H
@@ -0,0 +1,128 @@
+/***************************
+@File: UQuiescence.h
+@Desc: 线程池的静默控制。记录已写入未执行完的任务个数，减为0时唤醒等待方；
+       暂停时，工作线程不再获取任务，阻塞等待恢复
+***************************/
+
+#ifndef UQUIESCENCE_H
+#define UQUIESCENCE_H
+
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
+#include "../ThreadPoolinc.hpp"
+#include "../UtilsDefine.hpp"
+
+class UQuiescence {
+public:
+    explicit UQuiescence() = default;
+
+    /**
+     * 任务写入队列之前调用，保证计数不会先于写入被减少
+     * @param size
+     */
+    CVoid add(CLong size = 1) {
+        in_flight_.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    /**
+     * 任务执行完成后调用。减为0时，唤醒所有等待方
+     * @param size
+     */
+    CVoid done(CLong size = 1) {
+        if (size == in_flight_.fetch_sub(size, std::memory_order_seq_cst)
+            && waiter_num_.load(std::memory_order_seq_cst) > 0) {
+            LOCK_GUARD lk(mutex_);    // 加锁后通知，避免等待方检查条件后、挂起前丢失通知
+            idle_cv_.notify_all();
+        }
+    }
+
+    /**
+     * 等待所有任务执行完成
+     * @param ttl 最大等待时间，单位为ms
+     * @return 超时返回false
+     */
+    CBool waitIdle(CMSec ttl) {
+        waiter_num_.fetch_add(1, std::memory_order_seq_cst);
+        CBool result = true;
+        {
+            UNIQUE_LOCK lk(mutex_);
+            result = idle_cv_.wait_for(lk, std::chrono::milliseconds(ttl), [this] {
+                return in_flight_.load(std::memory_order_acquire) <= 0;
+            });
+        }
+        waiter_num_.fetch_sub(1, std::memory_order_relaxed);
+        return result;
+    }
+
+    /**
+     * 线程池销毁时，未执行的任务被丢弃，重置计数并唤醒等待方
+     * @param size 保留下来、之后仍会执行的任务个数
+     */
+    CVoid reset(CLong size = 0) {
+        LOCK_GUARD lk(mutex_);
+        in_flight_.store(size, std::memory_order_release);
+        idle_cv_.notify_all();
+    }
+
+    [[nodiscard]] CLong getInFlight() const {
+        return in_flight_.load(std::memory_order_relaxed);
+    }
+
+    CVoid pause() {
+        is_paused_.store(true, std::memory_order_release);
+    }
+
+    CVoid resume() {
+        {
+            LOCK_GUARD lk(mutex_);
+            is_paused_.store(false, std::memory_order_release);
+        }
+        resume_cv_.notify_all();
+    }
+
+    /**
+     * 是否处于暂停状态。工作线程每轮循环检查一次，未暂停时仅为一次原子读取
+     * @return
+     */
+    [[nodiscard]] CBool isPaused() const {
+        return is_paused_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * 暂停时阻塞等待，直到恢复或线程被停止
+     * @param done 线程的运行标记，修改后需要调用 wakeAll()
+     */
+    CVoid waitResume(const std::atomic<bool>& done) {
+        UNIQUE_LOCK lk(mutex_);
+        resume_cv_.wait(lk, [this, &done] {
+            return !is_paused_.load(std::memory_order_acquire) || !done.load(std::memory_order_acquire);
+        });
+    }
+
+    /**
+     * 唤醒所有暂停中的线程，使其重新检查运行标记
+     */
+    CVoid wakeAll() {
+        {
+            LOCK_GUARD lk(mutex_);
+        }
+        resume_cv_.notify_all();
+    }
+
+    NO_ALLOWED_COPY(UQuiescence)
+
+private:
+    std::atomic<CLong> in_flight_ { 0 };                         // 已写入未执行完的任务个数
+    std::atomic<int> waiter_num_ { 0 };                          // waitIdle() 的等待方个数，为0时不需要通知
+    std::atomic<CBool> is_paused_ { false };                     // 是否暂停获取任务
+    std::mutex mutex_;
+    std::condition_variable idle_cv_;                            // 任务全部完成时通知
+    std::condition_variable resume_cv_;                          // 恢复或停止时通知
+};
+
+using UQuiescencePtr = UQuiescence *;
+
+#endif //UQUIESCENCE_H
@@ -3,6 +3,8 @@
 
 #include <thread>
 #include <algorithm>
+#include <chrono>
+#include <atomic>
 
 #include "../ThreadPoolinc.hpp"
 #include "../Queue/UQueueInclude.hpp"
@@ -10,6 +12,10 @@
 #include "../Task/UTask.hpp"
 #include "../UtilsDefine.hpp"
 #include "../UAllocator.hpp"
+#include "../UTrace.hpp"
+#include "../Timer/UTimerWheel.hpp"
+#include "../Lane/ULane.hpp"
+#include "./UQuiescence.hpp"
 
 
 class UThreadBase : CObject{
@@ -21,6 +27,7 @@ protected:
         pool_task_queue_ = nullptr;
         pool_priority_task_queue_ = nullptr;
         config_ = nullptr;
+        timer_wheel_ = nullptr;
         total_task_num_ = 0;
     }
 
@@ -49,7 +56,7 @@ protected:
      * @param task
      * @return
      */
-    virtual bool popPoolTask(UTaskRef task) {
+    bool popPoolTask(UTaskRef task) {
         bool result = pool_task_queue_->tryPop(task);
         if (!result && THREAD_TYPE_SECONDARY == type_) {
             // 如果辅助线程没有获取到的话，还需要再尝试从长时间任务队列中，获取一次
@@ -64,8 +71,8 @@ protected:
      * @param tasks
      * @return
      */
-    virtual bool popPoolTask(UTaskArrRef tasks) {
-        bool result = pool_task_queue_->tryPop(tasks, config_->max_pool_batch_size_);
+    bool popPoolTask(UTaskArrRef tasks) {
+        bool result = pool_task_queue_->tryPop(tasks, calcBatchSize(config_->max_pool_batch_size_));
         if (!result && THREAD_TYPE_SECONDARY == type_) {
             result = pool_priority_task_queue_->tryPop(tasks, 1);    // 从优先队列里，最多pop出来一个
         }
@@ -74,28 +81,188 @@ protected:
 
 
     /**
-     * 执行单个任务
+     * 设置通道信息，需要在init之前使用
+     * @param lanes 所有的通道
+     * @param ownLane 专属通道，可以为空
+     * @return
+     */
+    CStatus setLaneInfo(std::vector<ULanePtr>* lanes, ULanePtr ownLane) {
+        FUNCTION_BEGIN
+        ASSERT_INIT(false)
+        ASSERT_NOT_NULL(lanes)
+
+        this->pool_lanes_ = lanes;
+        this->own_lane_ = ownLane;
+        FUNCTION_END
+    }
+
+
+    /**
+     * 设置线程池的静默控制，需要在init之前使用
+     * @param quiescence
+     * @return
+     */
+    CStatus setQuiescence(UQuiescencePtr quiescence) {
+        FUNCTION_BEGIN
+        ASSERT_INIT(false)
+
+        this->quiescence_ = quiescence;
+        FUNCTION_END
+    }
+
+
+    /**
+     * 线程池暂停时，阻塞等待恢复或线程停止
+     */
+    CVoid checkPause() {
+        if (nullptr != quiescence_ && quiescence_->isPaused()) {
+            quiescence_->waitResume(done_);
+        }
+    }
+
+
+    /**
+     * 从通道中获取任务。优先获取专属通道的任务，为空时再按照权重轮询其他通道
+     * @param task
+     * @return
+     */
+    bool popLaneTask(UTaskRef task) {
+        if (nullptr == pool_lanes_ || pool_lanes_->empty()) {
+            return false;
+        }
+
+        if (nullptr != own_lane_ && own_lane_->tryPop(task, false)) {
+            return true;
+        }
+        return lane_scheduler_.pop(*pool_lanes_, own_lane_, task);
+    }
+
+
+    /**
+     * 从通道中获取任务，写入批量任务中。每次仅获取一个，保证权重的准确性
+     * @param tasks
+     * @return
+     */
+    bool popLaneTask(UTaskArrRef tasks) {
+        UTask task;
+        if (!popLaneTask(task)) {
+            return false;
+        }
+        tasks.emplace_back(std::move(task));
+        return true;
+    }
+
+
+    /**
+     * 获取当前线程对应的工作线程（主线程或辅助线程），非工作线程返回nullptr
+     * @return
+     */
+    static UThreadBase*& currentThread() {
+        static thread_local UThreadBase* thread = nullptr;
+        return thread;
+    }
+
+
+    /**
+     * 执行单个任务。可以在其他任务的执行过程中嵌套调用（如 TaskScope、strand、yieldPoint），
+     * 嵌套调用结束后保持外层任务的执行状态
      * @param task
      */
     CVoid runTask(UTask& task) {
+        bool running = is_running_;
         is_running_ = true;
-        task();
+        UTaskHooks::beforeRun(task.getHookContext());
+        UTHREADPOOL_TRACE(task_run, task.getTraceId(), type_);
+        runLabeledTask(task);
+        UTHREADPOOL_TRACE(task_done, task.getTraceId(), type_);
+        UTaskHooks::afterRun(task.getHookContext());
         total_task_num_++;
-        is_running_ = false;
+        is_running_ = running;
+        if (nullptr != quiescence_) {
+            quiescence_->done();
+        }
+    }
+
+
+    /**
+     * 执行任务。开启标签统计时，执行期间将任务的标签设为当前标签，使嵌套提交的任务继承该标签，
+     * 并每隔 label_sample_period_ 个任务统计一次cpu耗时
+     * @param task
+     */
+    CVoid runLabeledTask(UTask& task) {
+        const CSize period = config_->label_sample_period_;
+        if (likely(0 == period)) {
+            task();
+            return;
+        }
+
+        CUint label = task.getLabel();
+        UTaskLabel::Scope scope(label);
+        if (!UTaskLabel::needSample(period)) {
+            task();
+            UTaskLabel::record(label, 0, false, period);
+            return;
+        }
+
+        CULong start = UTaskLabel::getThreadCpuTime();
+        task();
+        UTaskLabel::record(label, UTaskLabel::getThreadCpuTime() - start, true, period);
     }
 
 
     /**
-     * 批量执行任务
+     * 批量执行任务，执行后清空tasks，保留其容量以便复用
      * @param tasks
      */
     CVoid runTasks(UTaskArr& tasks) {
         is_running_ = true;
+        auto start = std::chrono::steady_clock::now();
         for (auto& task : tasks) {
-            task();
+            UTaskHooks::beforeRun(task.getHookContext());
+            UTHREADPOOL_TRACE(task_run, task.getTraceId(), type_);
+            runLabeledTask(task);
+            UTHREADPOOL_TRACE(task_done, task.getTraceId(), type_);
+            UTaskHooks::afterRun(task.getHookContext());
         }
+        auto span = std::chrono::steady_clock::now() - start;
+        updateTaskCost(std::chrono::duration_cast<std::chrono::nanoseconds>(span).count(), tasks.size());
         total_task_num_ += tasks.size();
         is_running_ = false;
+        if (nullptr != quiescence_) {
+            quiescence_->done((CLong)tasks.size());
+        }
+        tasks.clear();
+    }
+
+
+    /**
+     * 计算本次批量获取的任务个数
+     * 单个任务耗时越短，批量越大，使得每批任务的耗时接近 batch_time_budget_
+     * @param fixedSize 未开启自动调整，或者还没有耗时信息时使用
+     * @return
+     */
+    [[nodiscard]] int calcBatchSize(int fixedSize) const {
+        if (!config_->adaptive_batch_enable_ || 0 == task_cost_) {
+            return fixedSize;
+        }
+
+        CLong size = (CLong)config_->batch_time_budget_ * 1000 / task_cost_;
+        return (int)std::min<CLong>(std::max<CLong>(size, 1), config_->max_adaptive_batch_size_);
+    }
+
+
+    /**
+     * 更新单个任务的平均耗时（指数加权，权重为1/8）
+     * @param span 本批任务的总耗时，单位为ns
+     * @param size 本批任务个数
+     */
+    CVoid updateTaskCost(CLong span, CSize size) {
+        if (0 == size) {
+            return;
+        }
+
+        CLong cost = std::max<CLong>(span / (CLong)size, 1);
+        task_cost_ = (0 == task_cost_) ? cost : task_cost_ + (cost - task_cost_) / 8;
     }
 
 
@@ -104,6 +271,9 @@ protected:
      */
     CVoid reset() {
         done_ = false;
+        if (nullptr != quiescence_) {
+            quiescence_->wakeAll();    // 暂停中的线程需要被唤醒，才能退出
+        }
         if (thread_.joinable()) {
             thread_.join();    // 等待线程结束
         }
@@ -116,6 +286,7 @@ protected:
     /**
     * 设置线程优先级，仅针对非windows平台使用
     * 如果设置优先级的话，也就不需要使用优先级队列
+    * 需要在线程内部调用，各线程启动后自行设置，创建方无需等待
     */
     CVoid setSchedParam() {
 #ifndef _WIN32
@@ -129,7 +300,7 @@ protected:
             policy = config_->secondary_thread_policy_;
         }
 
-        auto handle = thread_.native_handle();
+        auto handle = pthread_self();
         sched_param param = { calcPriority(priority) };
         int ret = pthread_setschedparam(handle, calcPolicy(policy), &param);
         if (0 != ret) {
@@ -139,7 +310,7 @@ protected:
     }
 
     /**
-     * 设置线程亲和性，仅针对linux系统
+     * 设置线程亲和性，仅针对linux系统。需要在线程内部调用
      */
     CVoid setAffinity(int index) {
 #ifdef __linux__
@@ -151,7 +322,7 @@ protected:
         CPU_ZERO(&mask);
         CPU_SET(index % CPU_NUM, &mask);
 
-        auto handle = thread_.native_handle();
+        auto handle = pthread_self();
         int ret = pthread_setaffinity_np(handle, sizeof(cpu_set_t), &mask);
         if (0 != ret) {
             std::cout << "warning : set thread affinity failed, error code is " << ret << std::endl;
@@ -189,17 +360,28 @@ private:
 
 
 protected:
-    bool done_;                                                        // 线程状态标记
+    std::atomic<bool> done_;                                           // 线程状态标记，resize时由其他线程修改
     bool is_init_;                                                     // 标记初始化状态
     bool is_running_;                                                  // 是否正在执行
     int type_ = 0;                                                     // 用于区分线程类型（主线程、辅助线程）
     unsigned long total_task_num_ = 0;                                 // 处理的任务的数字
+    CLong task_cost_ = 0;                                              // 单个任务的平均耗时，单位为ns，为0表示暂无统计
+    UTaskArr batch_tasks_;                                             // 批量任务的缓存，循环复用，避免重复申请内存
 
     UAtomicQueue<UTask>* pool_task_queue_;                             // 用于存放线程池中的普通任务
     UAtomicPriorityQueue<UTask>* pool_priority_task_queue_;            // 用于存放线程池中的包含优先级任务的队列，仅辅助线程可以执行
     UThreadPoolConfigPtr config_ = nullptr;                            // 配置参数信息
+    UTimerWheelPtr timer_wheel_ = nullptr;                             // 时间轮，非空时由本线程在空闲时推进
+    std::vector<ULanePtr>* pool_lanes_ = nullptr;                      // 线程池中的所有通道，init之后不再变化
+    ULanePtr own_lane_ = nullptr;                                      // 专属通道，非空时优先处理
+    ULaneScheduler lane_scheduler_;                                    // 通道的轮询信息
+    UQuiescencePtr quiescence_ = nullptr;                              // 线程池的静默控制，记录任务完成和暂停状态
     std::thread thread_;                                               // 线程类
+
+    friend class UThreadPool;
 };
 
 
+using UThreadBasePtr = UThreadBase *;
+
 #endif //UTHREADBASE_H
@@ -2,6 +2,9 @@
 #define UTHREADPRIMARY_H
 
 #include "./UThreadBase.hpp"
+#include "./UIdleBitmap.hpp"
+#include "../USpinLock.hpp"
+#include "../Reactor/UReactor.hpp"
 #include "../UtilsDefine.hpp"
 #include "../CFuncType.hpp"
 
@@ -19,9 +22,10 @@ protected:
         ASSERT_INIT(false)
 
         is_init_ = true;
+        done_ = true;    // 被回收的线程，可以重新init
+        is_idle_ = false;
+        mailbox_.open();
         thread_ = std::move(std::thread(&UThreadPrimary::run, this));
-        setSchedParam();
-        setAffinity(index_);
         FUNCTION_END
     }
 
@@ -30,23 +34,47 @@ protected:
      * 注册线程池相关内容，需要在init之前使用
      * @param index
      * @param poolTaskQueue
-     * @param poolThreads
+     * @param poolThreads 所有主线程的槽位，init之后不再变化
+     * @param poolThreadSize 当前生效的主线程数，即 poolThreads 中前n个
      * @param config
+     * @param timerWheel 空闲时需要推进的时间轮，可以为空
+     * @param reactor 空闲时需要轮询的反应器，可以为空
      */
     CStatus setThreadPoolInfo(int index,
                               UAtomicQueue<UTask>* poolTaskQueue,
                               std::vector<UThreadPrimary *>* poolThreads,
-                              UThreadPoolConfigPtr config) {
+                              std::atomic<int>* poolThreadSize,
+                              UThreadPoolConfigPtr config,
+                              UTimerWheelPtr timerWheel = nullptr,
+                              UReactorPtr reactor = nullptr) {
         FUNCTION_BEGIN
         ASSERT_INIT(false)    // 初始化之前，设置参数
         ASSERT_NOT_NULL(poolTaskQueue)
         ASSERT_NOT_NULL(poolThreads)
+        ASSERT_NOT_NULL(poolThreadSize)
         ASSERT_NOT_NULL(config)
 
         this->index_ = index;
         this->pool_task_queue_ = poolTaskQueue;
         this->pool_threads_ = poolThreads;
+        this->pool_thread_size_ = poolThreadSize;
         this->config_ = config;
+        this->timer_wheel_ = timerWheel;
+        this->reactor_ = reactor;
+        FUNCTION_END
+    }
+
+
+    /**
+     * 设置空闲标记信息，需要在init之前使用。不设置时，不接收直接投递的任务
+     * @param idleBitmap
+     * @return
+     */
+    CStatus setIdleInfo(UIdleBitmapPtr idleBitmap) {
+        FUNCTION_BEGIN
+        ASSERT_INIT(false)
+
+        this->idle_bitmap_ = idleBitmap;
         FUNCTION_END
     }
 
@@ -73,30 +101,50 @@ protected:
             RETURN_ERROR_STATUS("primary thread is null")
         }
 
+        setSchedParam();
+        setAffinity(index_);
+        current() = this;
+        currentThread() = this;
         if (config_->calcBatchTaskRatio()) {
             while (done_) {
+                checkPause();
                 processTasks();    // 批量任务获取执行接口
             }
         } else {
             while (done_) {
+                checkPause();
                 processTask();    // 单个任务获取执行接口
             }
         }
+        current() = nullptr;
+        currentThread() = nullptr;
 
         FUNCTION_END
     }
 
 
+    /**
+     * 获取当前线程对应的主线程，非主线程返回nullptr
+     * @return
+     */
+    static UThreadPrimary*& current() {
+        static thread_local UThreadPrimary* primary = nullptr;
+        return primary;
+    }
+
+
     /**
      * 获取并执行任务
      * @return
      */
     CVoid processTask() {
+        drainInbox();
         UTask task;
-        if (popTask(task) || popPoolTask(task) || stealTask(task)) {
+        if (mailbox_.tryTake(task) || popTask(task) || popPoolTask(task) || popLaneTask(task) || stealTask(task)) {
+            markBusy();
             runTask(task);
         } else {
-            std::this_thread::yield(); // 没有任务就不要阻塞，让出cpu
+            processIdle();
         }
     }
 
@@ -105,12 +153,104 @@ protected:
      * 获取批量执行task信息
      */
     CVoid processTasks() {
-        UTaskArr tasks;
-        if (popTask(tasks) || popPoolTask(tasks) || stealTask(tasks)) {
+        drainInbox();
+        UTaskArrRef tasks = batch_tasks_;
+        if (popMailbox(tasks) || popTask(tasks) || popPoolTask(tasks) || popLaneTask(tasks) || stealTask(tasks)) {
             // 尝试从主线程中获取/盗取批量task，如果成功，则依次执行
+            markBusy();
             runTasks(tasks);
         } else {
-            std::this_thread::yield();
+            processIdle();
+        }
+    }
+
+
+    /**
+     * 将收件队列中外部写入的任务批量转入本地队列。可以在任意线程中调用：
+     * 本线程正常取出；本线程阻塞或已被回收时，由补偿线程或窃取方代为转入，避免任务一直等待
+     * 同一时刻仅允许一个线程取出，其他线程调用时直接返回0。本地队列只加锁一次，之后的弹出和窃取不受外部写入影响
+     * @return 转入的任务个数
+     */
+    CSize drainInbox() {
+        if (0 == inbox_.size() || !inbox_lock_.tryLock()) {
+            return 0;
+        }
+
+        UTask task;
+        while (inbox_tasks_.size() < MAX_INBOX_DRAIN_SIZE && inbox_.tryPop(task)) {
+            inbox_tasks_.emplace_back(std::move(task));
+        }
+        CSize size = inbox_tasks_.size();
+        work_stealing_queue_.push(inbox_tasks_);
+        inbox_lock_.unlock();
+        return size;
+    }
+
+
+    /**
+     * 获取积压的任务个数，包含收件队列中尚未转入的任务。近似值，用于分发和窃取时的比较
+     * @return
+     */
+    [[nodiscard]] CSize getLoad() const {
+        return work_stealing_queue_.size() + inbox_.size();
+    }
+
+
+    /**
+     * 没有任务时，轮询反应器并推进时间轮，都没有产生任务时让出cpu
+     * 就绪的io事件放入本线程的队列中，下一轮直接执行，其他线程也可以窃取
+     */
+    CVoid processIdle() {
+        if (nullptr != reactor_ && reactor_->tryPoll(batch_tasks_) > 0) {
+            if (nullptr != quiescence_) {
+                quiescence_->add((CLong)batch_tasks_.size());
+            }
+            for (auto& task : batch_tasks_) {
+                work_stealing_queue_.push(std::move(task));
+            }
+            batch_tasks_.clear();
+        } else if (nullptr == timer_wheel_ || 0 == timer_wheel_->tryAdvance()) {
+            markIdle();
+            UTaskHooks::onIdle(index_);
+            std::this_thread::yield(); // 没有任务就不要阻塞，让出cpu
+        }
+    }
+
+
+    /**
+     * 从信箱中取出直接投递的任务
+     * @param tasks
+     * @return
+     */
+    bool popMailbox(UTaskArrRef tasks) {
+        UTask task;
+        if (!mailbox_.tryTake(task)) {
+            return false;
+        }
+
+        tasks.emplace_back(std::move(task));
+        return true;
+    }
+
+
+    /**
+     * 标记为空闲，提交方可以直接向信箱中投递任务。仅在状态变化时修改标记
+     */
+    CVoid markIdle() {
+        if (nullptr != idle_bitmap_ && !is_idle_) {
+            is_idle_ = true;
+            idle_bitmap_->set(index_);
+        }
+    }
+
+
+    /**
+     * 标记为忙碌。空闲标记可能已经被提交方认领并清除，重复清除不影响
+     */
+    CVoid markBusy() {
+        if (is_idle_) {
+            is_idle_ = false;
+            idle_bitmap_->reset(index_);
         }
     }
 
@@ -131,7 +271,7 @@ protected:
      * @return
      */
     bool popTask(UTaskArrRef tasks) {
-        return work_stealing_queue_.tryPop(tasks, config_->max_local_batch_size_);
+        return work_stealing_queue_.tryPop(tasks, calcBatchSize(config_->max_local_batch_size_));
     }
 
 
@@ -141,32 +281,43 @@ protected:
      * @return
      */
     bool stealTask(UTaskRef task) {
-        if (unlikely(pool_threads_->size() < config_->default_thread_size_)) {
-            /**
-             * 线程池还未初始化完毕的时候，无法进行steal。
-             * 确保程序安全运行。
-             */
-            return false;
-        }
-
         /**
          * 窃取的时候，仅从相邻的primary线程中窃取
-         * 待窃取相邻的数量，不能超过默认primary线程数
+         * 待窃取相邻的数量，不能超过当前primary线程数
          */
-        int range = config_->calcStealRange();
+        int size = pool_thread_size_->load(std::memory_order_acquire);
+        int range = config_->calcStealRange(size);
         for (int i = 0; i < range; i++) {
             /**
             * 从线程中周围的thread中，窃取任务。
             * 如果成功，则返回true，并且执行任务。
             */
-            int curIndex = (index_ + i + 1) % config_->default_thread_size_;
-            if (nullptr != (*pool_threads_)[curIndex]
-                && ((*pool_threads_)[curIndex])->work_stealing_queue_.trySteal(task)) {
+            int curIndex = (index_ + i + 1) % size;
+            auto victim = (*pool_threads_)[curIndex];
+            // 对方阻塞或执行长任务时，收件队列中的任务不会被及时转入，代为转入后再窃取
+            if (nullptr != victim
+                && (victim->work_stealing_queue_.trySteal(task)
+                    || (victim->drainInbox() > 0 && victim->work_stealing_queue_.trySteal(task)))) {
+                UTaskHooks::onSteal(curIndex, 1);
                 return true;
             }
         }
 
-        return false;
+        // 已回收的线程中，可能还有缩容时刚写入的任务（包括写入收件队列的任务）
+        for (int i = size; i < (int)pool_threads_->size(); i++) {
+            auto victim = (*pool_threads_)[i];
+            if (0 == victim->getLoad()) {
+                continue;
+            }
+
+            victim->drainInbox();
+            if (victim->work_stealing_queue_.trySteal(task)) {
+                UTaskHooks::onSteal(i, 1);
+                return true;
+            }
+        }
+
+        return stealMailbox(task, size, range);
     }
 
 
@@ -176,19 +327,69 @@ protected:
      * @return
      */
     bool stealTask(UTaskArrRef tasks) {
-        if (unlikely(pool_threads_->size() < config_->default_thread_size_)) {
+        int size = pool_thread_size_->load(std::memory_order_acquire);
+        int range = config_->calcStealRange(size);
+        int batchSize = calcBatchSize(config_->max_steal_batch_size_);
+        for (int i = 0; i < range; i++) {
+            int curIndex = (index_ + i + 1) % size;
+            auto victim = (*pool_threads_)[curIndex];
+            if (nullptr == victim) {
+                continue;
+            }
+
+            // 自动调整时，最多窃取对方一半的任务，避免任务在线程间来回搬运
+            int stealSize = config_->adaptive_batch_enable_
+                            ? std::min(batchSize, std::max((int)(victim->getLoad() / 2), 1))
+                            : batchSize;
+            if (victim->work_stealing_queue_.trySteal(tasks, stealSize)
+                || (victim->drainInbox() > 0 && victim->work_stealing_queue_.trySteal(tasks, stealSize))) {
+                UTaskHooks::onSteal(curIndex, tasks.size());
+                return true;
+            }
+        }
+
+        for (int i = size; i < (int)pool_threads_->size(); i++) {
+            auto victim = (*pool_threads_)[i];
+            if (0 == victim->getLoad()) {
+                continue;
+            }
+
+            victim->drainInbox();
+            if (victim->work_stealing_queue_.trySteal(tasks, batchSize)) {
+                UTaskHooks::onSteal(i, tasks.size());
+                return true;
+            }
+        }
+
+        UTask task;
+        if (stealMailbox(task, size, range)) {
+            tasks.emplace_back(std::move(task));
+            return true;
+        }
+        return false;
+    }
+
+
+    /**
+     * 从相邻线程的信箱中取出任务。信箱所属线程未被调度时，避免任务一直等待
+     * @param task
+     * @param size 当前生效的主线程数
+     * @param range 窃取范围
+     * @return
+     */
+    bool stealMailbox(UTaskRef task, int size, int range) {
+        if (nullptr == idle_bitmap_) {
             return false;
         }
 
-        int range = config_->calcStealRange();
         for (int i = 0; i < range; i++) {
-            int curIndex = (index_ + i + 1) % config_->default_thread_size_;
-            if (nullptr != (*pool_threads_)[curIndex]
-                && ((*pool_threads_)[curIndex])->work_stealing_queue_.trySteal(tasks, config_->max_steal_batch_size_)) {
+            int curIndex = (index_ + i + 1) % size;
+            auto victim = (*pool_threads_)[curIndex];
+            if (nullptr != victim && victim->mailbox_.tryTake(task)) {
+                UTaskHooks::onSteal(curIndex, 1);
                 return true;
             }
         }
-
         return false;
     }
 
@@ -196,8 +397,19 @@ private:
     int index_ {SECONDARY_THREAD_COMMON_ID};                // 线程index
     UWorkStealingQueue work_stealing_queue_;                       // 内部队列信息
     std::vector<UThreadPrimary *>* pool_threads_;                  // 用于存放线程池中的线程信息
+    std::atomic<int>* pool_thread_size_ = nullptr;                 // 当前生效的主线程数
+    int blocking_depth_ = 0;                                       // BlockingScope的嵌套层数，仅本线程访问
+    int yield_depth_ = 0;                                          // yieldPoint() 的嵌套层数，仅本线程访问
+    UReactorPtr reactor_ = nullptr;                                // io反应器，非空时由本线程在空闲时轮询
+    UMailbox mailbox_;                                             // 直接投递任务的信箱
+    UMpscQueue<UTask> inbox_;                                      // 收件队列，外部线程写入，仅本线程取出
+    UTaskArr inbox_tasks_;                                         // 从收件队列转出的任务缓存，循环复用，持有 inbox_lock_ 时访问
+    USpinLock inbox_lock_;                                         // 保证同一时刻仅有一个线程从收件队列取出
+    UIdleBitmapPtr idle_bitmap_ = nullptr;                         // 线程池的空闲标记，为空表示不开启直接投递
+    bool is_idle_ = false;                                         // 本线程是否已标记为空闲，仅本线程访问
 
     friend class UThreadPool;
+    friend class UThreadSecondary;
     friend class UAllocator;
 };
 
@@ -6,7 +6,10 @@
 #ifndef UTHREADSECONDARY_H
 #define UTHREADSECONDARY_H
 
+#include <condition_variable>
+
 #include "./UThreadBase.hpp"
+#include "./UThreadPrimary.hpp"
 #include "../UtilsDefine.hpp"
 #include "../CFuncType.hpp"
 
@@ -27,7 +30,6 @@ protected:
         cur_ttl_ = config_->secondary_thread_ttl_;
         is_init_ = true;
         thread_ = std::move(std::thread(&UThreadSecondary::run, this));
-        setSchedParam();
         FUNCTION_END
     }
 
@@ -55,20 +57,49 @@ protected:
     }
 
 
+    /**
+     * 设置可以窃取的主线程信息，需要在init之前使用。不设置时，不窃取任务
+     * @param poolThreads
+     * @param poolThreadSize
+     * @return
+     */
+    CStatus setStealInfo(std::vector<UThreadPrimary *>* poolThreads,
+                         std::atomic<int>* poolThreadSize) {
+        FUNCTION_BEGIN
+        ASSERT_INIT(false)
+        ASSERT_NOT_NULL(poolThreads)
+        ASSERT_NOT_NULL(poolThreadSize)
+
+        this->pool_threads_ = poolThreads;
+        this->pool_thread_size_ = poolThreadSize;
+        FUNCTION_END
+    }
+
+
     CStatus run() {
         FUNCTION_BEGIN
         ASSERT_INIT(true)
         ASSERT_NOT_NULL(config_)
 
-        if (config_->calcBatchTaskRatio()) {
+        setSchedParam();
+        currentThread() = this;
+        if (is_compensate_) {
+            while (done_) {
+                checkPause();
+                processCompensateTask();    // 补偿线程，接管被阻塞的主线程的队列
+            }
+        } else if (config_->calcBatchTaskRatio()) {
             while (done_) {
+                checkPause();
                 processTasks();    // 批量任务获取执行接口
             }
         } else {
             while (done_) {
+                checkPause();
                 processTask();    // 单个任务获取执行接口
             }
         }
+        currentThread() = nullptr;
 
         FUNCTION_END
     }
@@ -76,12 +107,19 @@ protected:
 
     /**
      * 任务执行函数，从线程池的任务队列中获取信息
+     * 通道的专属线程，仅处理通道中的任务
      */
     CVoid processTask() {
+        if (is_parked_.load(std::memory_order_acquire)) {
+            waitActivate();
+            return;
+        }
+
         UTask task;
-        if (popPoolTask(task)) {
+        if ((nullptr == own_lane_ && popPoolTask(task)) || popLaneTask(task) || stealTask(task)) {
             runTask(task);
         } else {
+            UTaskHooks::onIdle(SECONDARY_THREAD_COMMON_ID);
             std::this_thread::yield();
         }
     }
@@ -91,15 +129,175 @@ protected:
      * 批量执行n个任务
      */
     CVoid processTasks() {
-        UTaskArr tasks;
-        if (popPoolTask(tasks)) {
+        if (is_parked_.load(std::memory_order_acquire)) {
+            waitActivate();
+            return;
+        }
+
+        UTaskArrRef tasks = batch_tasks_;
+        if ((nullptr == own_lane_ && popPoolTask(tasks)) || popLaneTask(tasks) || stealTask(tasks)) {
             runTasks(tasks);
         } else {
+            UTaskHooks::onIdle(SECONDARY_THREAD_COMMON_ID);
             std::this_thread::yield();
         }
     }
 
 
+    /**
+     * 从主线程中窃取一个任务，每次从不同的主线程开始，避免集中窃取同一个
+     * @param task
+     * @return
+     */
+    bool stealTask(UTaskRef task) {
+        if (nullptr == pool_threads_) {
+            return false;
+        }
+
+        int size = pool_thread_size_->load(std::memory_order_acquire);
+        for (int i = 0; i < size; i++) {
+            auto victim = (*pool_threads_)[(steal_cursor_ + i) % size];
+            if (victim->work_stealing_queue_.trySteal(task)) {
+                UTaskHooks::onSteal((steal_cursor_ + i) % size, 1);
+                steal_cursor_ = (steal_cursor_ + i + 1) % size;
+                return true;
+            }
+        }
+        return false;
+    }
+
+
+    /**
+     * 从主线程中窃取一批任务，最多取对方一半的任务
+     * @param tasks
+     * @return
+     */
+    bool stealTask(UTaskArrRef tasks) {
+        if (nullptr == pool_threads_) {
+            return false;
+        }
+
+        int size = pool_thread_size_->load(std::memory_order_acquire);
+        int batchSize = calcBatchSize(config_->max_steal_batch_size_);
+        for (int i = 0; i < size; i++) {
+            auto victim = (*pool_threads_)[(steal_cursor_ + i) % size];
+            int stealSize = std::min(batchSize, std::max((int)(victim->getLoad() / 2), 1));
+            if (victim->work_stealing_queue_.trySteal(tasks, stealSize)) {
+                UTaskHooks::onSteal((steal_cursor_ + i) % size, tasks.size());
+                steal_cursor_ = (steal_cursor_ + i + 1) % size;
+                return true;
+            }
+        }
+        return false;
+    }
+
+
+    /**
+     * 挂起，放入线程池的备用列表中。当前任务执行完成后生效
+     */
+    CVoid park() {
+        park_time_ = std::chrono::steady_clock::now();
+        is_parked_.store(true, std::memory_order_release);
+    }
+
+
+    /**
+     * 重新激活挂起的线程，无需重新创建
+     */
+    CVoid activate() {
+        {
+            LOCK_GUARD lk(park_mutex_);
+            cur_ttl_ = config_->secondary_thread_ttl_;
+            is_parked_.store(false, std::memory_order_release);
+        }
+        park_cv_.notify_one();
+    }
+
+
+    /**
+     * 挂起期间等待，直到被激活或者退出
+     */
+    CVoid waitActivate() {
+        UNIQUE_LOCK lk(park_mutex_);
+        park_cv_.wait(lk, [this] {
+            return !done_ || !is_parked_.load(std::memory_order_acquire);
+        });
+    }
+
+
+    /**
+     * 判断挂起的时间是否超过上限
+     * @param ttl 单位为s
+     * @return
+     */
+    bool isParkExpired(int ttl) const {
+        return std::chrono::steady_clock::now() - park_time_ > std::chrono::seconds(ttl);
+    }
+
+
+    /**
+     * 补偿线程的执行函数。未接管队列时挂起，不占用cpu
+     */
+    CVoid processCompensateTask() {
+        UThreadPrimary* primary = adopted_primary_.load(std::memory_order_acquire);
+        if (nullptr == primary) {
+            UNIQUE_LOCK lk(park_mutex_);
+            park_cv_.wait(lk, [this] {
+                return !done_ || nullptr != adopted_primary_.load(std::memory_order_acquire);
+            });
+            return;
+        }
+
+        // 阻塞期间，外部线程仍可能写入主线程的收件队列，由补偿线程转入后执行
+        UTask task;
+        primary->drainInbox();
+        if (primary->work_stealing_queue_.tryPop(task) || pool_task_queue_->tryPop(task)) {
+            runTask(task);
+        } else {
+            UTaskHooks::onIdle(SECONDARY_THREAD_COMMON_ID);
+            std::this_thread::yield();
+        }
+    }
+
+
+    /**
+     * 设置为补偿线程，需要在init之前使用
+     * @return
+     */
+    CStatus setCompensate() {
+        FUNCTION_BEGIN
+        ASSERT_INIT(false)
+
+        is_compensate_ = true;
+        FUNCTION_END
+    }
+
+
+    /**
+     * 接管主线程的队列（包括收件队列）。传入nullptr时，补偿线程在当前任务执行完成后挂起
+     * @param primary
+     */
+    CVoid adopt(UThreadPrimary* primary) {
+        {
+            LOCK_GUARD lk(park_mutex_);
+            adopted_primary_.store(primary, std::memory_order_release);
+        }
+        park_cv_.notify_one();
+    }
+
+
+    /**
+     * 唤醒挂起的线程（补偿线程或备用线程）并使其退出，需要在destroy之前调用
+     */
+    CVoid unpark() {
+        {
+            LOCK_GUARD lk(park_mutex_);
+            done_ = false;
+        }
+        park_cv_.notify_one();
+    }
+
+
     /**
      * 判断本线程是否需要被自动释放
      * @return
@@ -117,6 +315,15 @@ protected:
 
 private:
     int cur_ttl_ = 0;                                                      // 当前最大生存周期
+    CBool is_compensate_ = false;                                          // 是否为补偿线程
+    std::atomic<UThreadPrimary *> adopted_primary_ { nullptr };            // 补偿线程接管的主线程
+    std::mutex park_mutex_;
+    std::condition_variable park_cv_;                                      // 补偿线程和备用线程挂起时使用
+    std::atomic<bool> is_parked_ { false };                                // 是否处于备用状态
+    std::chrono::steady_clock::time_point park_time_;                      // 进入备用状态的时间
+    std::vector<UThreadPrimary *>* pool_threads_ = nullptr;                // 可以窃取的主线程，为空表示不窃取
+    std::atomic<int>* pool_thread_size_ = nullptr;                         // 当前生效的主线程数
+    int steal_cursor_ = 0;                                                 // 下一次开始窃取的主线程
 
     friend class UThreadPool;
 };
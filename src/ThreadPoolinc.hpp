@@ -60,6 +60,12 @@ static const int LONG_TIME_TASK_STRATEGY = -101;
 static const int REGION_TASK_STRATEGY = -102;                                        // region的调度策略
 static const int EVENT_TASK_STRATEGY = -103;                                         // event的调度策略
 
+/* 队列已满时的处理策略 */
+static const int OVERFLOW_POLICY_BLOCK = 1;                                          // 阻塞等待，超时后拒绝
+static const int OVERFLOW_POLICY_REJECT = 2;                                         // 直接拒绝
+static const int OVERFLOW_POLICY_CALLER_RUNS = 3;                                    // 在提交线程中直接执行
+static const int OVERFLOW_POLICY_SPILL = 4;                                          // 主线程队列已满时，放入pool的queue中
+
 /**
  * 以下为线程池配置信息
  */
@@ -71,14 +77,39 @@ static const bool BATCH_TASK_ENABLE = false;
 static const int MAX_LOCAL_BATCH_SIZE = 2;                                           // 批量执行本地任务最大值
 static const int MAX_POOL_BATCH_SIZE = 2;                                            // 批量执行通用任务最大值
 static const int MAX_STEAL_BATCH_SIZE = 2;                                           // 批量盗取任务最大值
+static const bool ADAPTIVE_BATCH_ENABLE = true;                                      // 是否根据任务耗时自动调整批量大小（开启后以上三个批量值仅作为初始值）
+static const int MAX_ADAPTIVE_BATCH_SIZE = 64;                                       // 自动调整时，批量大小的上限
+static const int BATCH_TIME_BUDGET = 200;                                            // 自动调整时，单批任务的目标耗时，单位为us
 static const bool FAIR_LOCK_ENABLE = false;                                          // 是否开启公平锁（非必须场景不建议开启，开启后BATCH_TASK_ENABLE无效）
 static const int SECONDARY_THREAD_TTL = 10;                                          // 辅助线程ttl(time to live)，单位为s
+static const int SECONDARY_RESERVE_SIZE = 4;                                         // 最多保留的备用辅助线程个数，备用线程挂起等待复用
+static const int SECONDARY_RESERVE_TTL = 60;                                         // 备用辅助线程的最长挂起时间，超时后释放，单位为s
 static const bool MONITOR_ENABLE = true;                                             // 是否开启监控程序（如果不开启，辅助线程策略将失效。建议开启）
+static const bool LAZY_PRIMARY_ENABLE = false;                                       // 是否延迟启动主线程，init时仅启动一个，其余在提交任务且主线程均忙碌时逐个启动
 static const int MONITOR_SPAN = 5;                                                   // 监控线程执行间隔，单位为s
 static const bool BIND_CPU_ENABLE = true;                                            // 是否开启绑定cpu模式（仅针对主线程）
 static const int PRIMARY_THREAD_POLICY = THREAD_SCHED_OTHER;                  // 主线程调度策略
 static const int SECONDARY_THREAD_POLICY = THREAD_SCHED_OTHER;                // 辅助线程调度策略
 static const int PRIMARY_THREAD_PRIORITY = THREAD_MIN_PRIORITY;               // 主线程调度优先级（取值范围0~99）
 static const int SECONDARY_THREAD_PRIORITY = THREAD_MIN_PRIORITY;             // 辅助线程调度优先级（取值范围0~99）
+static const CSize POOL_QUEUE_CAPACITY = 0;                                          // pool的queue容量，为0表示不限制
+static const CSize PRIMARY_QUEUE_CAPACITY = 0;                                       // 每个主线程queue的容量，为0表示不限制
+static const int OVERFLOW_POLICY = OVERFLOW_POLICY_BLOCK;                            // 队列已满时的处理策略
+static const CMSec OVERFLOW_BLOCK_TTL = 1000;                                        // 阻塞策略的最大等待时间，单位为ms
+static const float QUEUE_HIGH_WATERMARK = 0.8f;                                      // 高水位，占容量的比例
+static const float QUEUE_LOW_WATERMARK = 0.5f;                                       // 低水位，占容量的比例
+static const CMSec DEFAULT_TIMER_TICK = 1;                                           // 定时任务时间精度，单位为ms
+static const CUint DEFAULT_TIMER_CAPACITY = 4096;                                    // 最多同时存在的定时任务个数
+static const bool TIMER_BY_IDLE_WORKER = false;                                      // 是否由空闲的主线程推进时间轮（不开启则使用单独的定时线程）
+static const int MAX_COMPENSATE_THREAD_SIZE = 16;                                    // 任务阻塞时，最多同时存在的补偿线程个数
+static const CSize DEFAULT_STRAND_SHARD_SIZE = 64;                                   // 每种key类型的strand分片个数，分片内加锁查找key对应的strand
+static const CSize STRAND_BATCH_SIZE = 16;                                           // strand每次被调度时，最多连续执行的任务个数
+static const bool REACTOR_ENABLE = false;                                            // 是否开启io反应器（仅linux），由空闲的主线程轮询
+static const bool MAILBOX_ENABLE = false;                                            // 是否开启直接投递，有空闲主线程时任务直接写入其信箱
+static const bool INBOX_ENABLE = false;                                              // 是否开启收件队列，外部线程写入主线程时不与其竞争锁
+static const CSize MAX_INBOX_DRAIN_SIZE = 64;                                         // 主线程每次从收件队列转入本地队列的最大任务个数
+static const CSize LABEL_SAMPLE_PERIOD = 0;                                          // 按标签统计cpu耗时的采样间隔，每n个任务统计一次，为0表示不开启标签统计
+static const CSize MAX_TASK_LABEL_SIZE = 256;                                        // 最多注册的任务标签个数
+static const int MAX_YIELD_POINT_DEPTH = 2;                                          // yieldPoint() 中嵌套执行任务的最大层数，超过后将等待的任务交给其他线程
 
 #endif
\ No newline at end of file
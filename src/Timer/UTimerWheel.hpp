@@ -0,0 +1,383 @@
+/***************************
+@File: UTimerWheel.h
+@Desc: 分层时间轮，用于延时任务和周期任务的调度
+       添加和取消均为O(1)，节点在初始化时预分配，运行时不申请内存
+***************************/
+
+#ifndef UTIMERWHEEL_H
+#define UTIMERWHEEL_H
+
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <condition_variable>
+
+#include "../ThreadPoolinc.hpp"
+#include "../CFuncType.hpp"
+#include "../Task/UTask.hpp"
+
+using UTimerId = CULong;
+using UTimerSink = std::function<CVoid(UTaskArrRef)>;
+
+class UTimerWheel {
+    static const CUint WHEEL_BITS = 8;                                  // 每一层的槽位bit数
+    static const CUint WHEEL_SIZE = 1 << WHEEL_BITS;                    // 每一层的槽位数
+    static const CUint WHEEL_MASK = WHEEL_SIZE - 1;
+    static const CUint WHEEL_LEVELS = 4;                                // 层数，共可表示 2^32 个tick
+    static constexpr CUint NIL_NODE = 0xFFFFFFFF;                           // 空节点标识
+
+    struct UTimerNode {
+        DEFAULT_FUNCTION func_ = nullptr;                               // 定时执行的函数
+        CULong expire_ = 0;                                             // 到期tick
+        CULong interval_ = 0;                                           // 周期tick，为0表示仅执行一次
+        CUint gen_ = 0;                                                 // 版本号，防止id复用后误取消
+        CUint prev_ = NIL_NODE;
+        CUint next_ = NIL_NODE;
+        CUint level_ = 0;
+        CUint slot_ = 0;
+        CBool used_ = false;
+    };
+
+public:
+    explicit UTimerWheel() = default;
+
+    ~UTimerWheel() {
+        destroy();
+    }
+
+    /**
+     * 初始化时间轮，预先分配全部节点
+     * @param tick 时间精度，单位为ms
+     * @param capacity 最多同时存在的定时任务个数
+     * @param sink 到期任务的批量接收函数
+     * @return
+     */
+    CStatus init(CMSec tick, CUint capacity, const UTimerSink& sink) {
+        FUNCTION_BEGIN
+        if (tick <= 0 || 0 == capacity || !sink) {
+            RETURN_ERROR_STATUS("timer wheel param is invalid")
+        }
+
+        LOCK_GUARD lk(mutex_);
+        tick_ = tick;
+        sink_ = sink;
+        nodes_.clear();
+        nodes_.resize(capacity);
+        for (CUint i = 0; i < capacity; i++) {
+            nodes_[i].next_ = (i + 1 < capacity) ? i + 1 : NIL_NODE;
+        }
+        free_head_ = 0;
+        for (auto& level : slots_) {
+            std::fill(std::begin(level), std::end(level), NIL_NODE);
+        }
+        size_ = 0;
+        cur_tick_ = 0;
+        start_ = std::chrono::steady_clock::now();
+        stop_ = false;
+        FUNCTION_END
+    }
+
+    /**
+     * 添加定时任务
+     * @param func
+     * @param delay 延时时间，单位为ms
+     * @param interval 周期时间，单位为ms。为0表示仅执行一次
+     * @return 定时任务id，添加失败（容量已满）返回0
+     */
+    UTimerId add(DEFAULT_CONST_FUNCTION_REF func, CMSec delay, CMSec interval = 0) {
+        UTimerId id = 0;
+        CBool notify = false;
+        {
+            LOCK_GUARD lk(mutex_);
+            if (stop_ || NIL_NODE == free_head_) {
+                return id;
+            }
+
+            CUint index = free_head_;
+            auto& node = nodes_[index];
+            free_head_ = node.next_;
+
+            node.func_ = func;
+            node.interval_ = calcTicks(interval);
+            node.expire_ = std::max(nowTick(), cur_tick_) + std::max<CULong>(calcTicks(delay), 1);
+            node.gen_ = (0 == node.gen_ + 1) ? 1 : node.gen_ + 1;
+            node.used_ = true;
+            link(index);
+            size_++;
+
+            id = ((UTimerId)node.gen_ << 32) | index;
+            notify = (1 == size_ || node.expire_ < wait_tick_);    // 仅在需要提前唤醒时，通知定时线程
+        }
+
+        if (notify) {
+            cv_.notify_one();
+        }
+        return id;
+    }
+
+    /**
+     * 取消定时任务
+     * @param id
+     * @return 是否取消成功。已经执行完毕的单次任务，无法取消
+     */
+    CBool cancel(UTimerId id) {
+        CUint index = (CUint)(id & 0xFFFFFFFF);
+        CUint gen = (CUint)(id >> 32);
+
+        LOCK_GUARD lk(mutex_);
+        if (index >= nodes_.size()
+            || !nodes_[index].used_
+            || nodes_[index].gen_ != gen) {
+            return false;
+        }
+
+        unlink(index);
+        release(index);
+        return true;
+    }
+
+    /**
+     * 尝试推进时间轮。若其他线程正在推进，则直接返回
+     * 供空闲的工作线程调用
+     * @return 本次投递的任务个数
+     */
+    CSize tryAdvance() {
+        if (0 == size_) {
+            return 0;    // 无定时任务时，不加锁
+        }
+
+        UTaskArr tasks;
+        {
+            UNIQUE_LOCK lk(mutex_, std::try_to_lock);
+            if (!lk.owns_lock()) {
+                return 0;
+            }
+            advance(nowTick(), tasks);
+        }
+
+        return deliver(tasks);
+    }
+
+    /**
+     * 定时线程执行函数
+     * 没有定时任务的时候，一直处于等待状态
+     */
+    CVoid loop() {
+        UTaskArr tasks;
+        UNIQUE_LOCK lk(mutex_);
+        while (!stop_) {
+            if (0 == size_) {
+                wait_tick_ = NIL_TICK;
+                cv_.wait(lk);
+                continue;
+            }
+
+            CULong now = nowTick();
+            wait_tick_ = calcNextTick();
+            if (wait_tick_ > now) {
+                cv_.wait_until(lk, start_ + std::chrono::milliseconds(wait_tick_ * tick_));
+                continue;
+            }
+
+            advance(now, tasks);
+            lk.unlock();
+            deliver(tasks);
+            lk.lock();
+        }
+    }
+
+    /**
+     * 停止时间轮，并清空所有未执行的定时任务
+     * @return
+     */
+    CStatus destroy() {
+        FUNCTION_BEGIN
+        {
+            LOCK_GUARD lk(mutex_);
+            stop_ = true;
+            for (CUint i = 0; i < nodes_.size(); i++) {
+                if (nodes_[i].used_) {
+                    unlink(i);
+                    release(i);
+                }
+            }
+        }
+        cv_.notify_all();
+        FUNCTION_END
+    }
+
+    /**
+     * 获取当前定时任务个数
+     * @return
+     */
+    [[nodiscard]] CSize size() const {
+        return size_;
+    }
+
+    NO_ALLOWED_COPY(UTimerWheel)
+
+private:
+    static const CULong NIL_TICK = (CULong)-1;
+
+    CULong nowTick() const {
+        auto span = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_);
+        return (CULong)span.count() / tick_;
+    }
+
+    CULong calcTicks(CMSec ms) const {
+        return ms <= 0 ? 0 : ((CULong)ms + tick_ - 1) / tick_;
+    }
+
+    /**
+     * 根据到期时间，将节点挂到对应层级的槽位上
+     * @param index
+     */
+    CVoid link(CUint index) {
+        auto& node = nodes_[index];
+        CULong delta = node.expire_ > cur_tick_ ? node.expire_ - cur_tick_ : 0;
+        CULong expire = node.expire_;
+        CUint level = 0;
+        while (level + 1 < WHEEL_LEVELS && delta >= (1UL << (WHEEL_BITS * (level + 1)))) {
+            level++;
+        }
+        if (WHEEL_LEVELS - 1 == level) {
+            // 超过时间轮表示范围的，先放在最高层，到期后再重新计算
+            expire = std::min(expire, cur_tick_ + (1UL << (WHEEL_BITS * WHEEL_LEVELS)) - 1);
+        }
+
+        node.level_ = level;
+        node.slot_ = (CUint)((expire >> (WHEEL_BITS * level)) & WHEEL_MASK);
+        node.prev_ = NIL_NODE;
+        node.next_ = slots_[level][node.slot_];
+        if (NIL_NODE != node.next_) {
+            nodes_[node.next_].prev_ = index;
+        }
+        slots_[level][node.slot_] = index;
+    }
+
+    CVoid unlink(CUint index) {
+        auto& node = nodes_[index];
+        if (NIL_NODE != node.prev_) {
+            nodes_[node.prev_].next_ = node.next_;
+        } else {
+            slots_[node.level_][node.slot_] = node.next_;
+        }
+        if (NIL_NODE != node.next_) {
+            nodes_[node.next_].prev_ = node.prev_;
+        }
+        node.prev_ = NIL_NODE;
+        node.next_ = NIL_NODE;
+    }
+
+    CVoid release(CUint index) {
+        auto& node = nodes_[index];
+        node.func_ = nullptr;
+        node.used_ = false;
+        node.next_ = free_head_;
+        free_head_ = index;
+        size_--;
+    }
+
+    /**
+     * 计算下一个需要处理的tick。最晚不超过下一次层级迁移的时间点
+     * @return
+     */
+    CULong calcNextTick() const {
+        CULong boundary = (cur_tick_ | WHEEL_MASK) + 1;
+        for (CULong tick = cur_tick_ + 1; tick < boundary; tick++) {
+            if (NIL_NODE != slots_[0][tick & WHEEL_MASK]) {
+                return tick;
+            }
+        }
+        return boundary;
+    }
+
+    /**
+     * 将时间轮推进到 now，到期的任务放入tasks中
+     * @param now
+     * @param tasks
+     */
+    CVoid advance(CULong now, UTaskArrRef tasks) {
+        while (cur_tick_ < now) {
+            if (0 == size_) {
+                cur_tick_ = now;
+                break;
+            }
+
+            CULong next = calcNextTick();
+            if (next > now) {
+                cur_tick_ = now;    // 中间没有到期的槽位，直接跳过
+                break;
+            }
+            cur_tick_ = next;
+            step(tasks);
+        }
+    }
+
+    CVoid step(UTaskArrRef tasks) {
+        if (0 == (cur_tick_ & WHEEL_MASK)) {
+            // 低层转完一圈，将高层对应槽位中的节点，向下迁移
+            for (CUint level = 1; level < WHEEL_LEVELS; level++) {
+                CUint slot = (CUint)((cur_tick_ >> (WHEEL_BITS * level)) & WHEEL_MASK);
+                CUint index = slots_[level][slot];
+                slots_[level][slot] = NIL_NODE;
+                while (NIL_NODE != index) {
+                    CUint next = nodes_[index].next_;
+                    link(index);
+                    index = next;
+                }
+                if (0 != slot) {
+                    break;
+                }
+            }
+        }
+
+        CUint slot = (CUint)(cur_tick_ & WHEEL_MASK);
+        CUint index = slots_[0][slot];
+        slots_[0][slot] = NIL_NODE;
+        while (NIL_NODE != index) {
+            auto& node = nodes_[index];
+            CUint next = node.next_;
+            if (node.expire_ > cur_tick_) {
+                link(index);    // 超出范围的节点，重新计算位置
+            } else if (node.interval_ > 0) {
+                tasks.emplace_back(DEFAULT_FUNCTION(node.func_));
+                node.expire_ = std::max(node.expire_ + node.interval_, cur_tick_ + 1);
+                link(index);
+            } else {
+                tasks.emplace_back(std::move(node.func_));
+                node.prev_ = NIL_NODE;
+                release(index);
+            }
+            index = next;
+        }
+    }
+
+    CSize deliver(UTaskArrRef tasks) {
+        CSize size = tasks.size();
+        if (size > 0) {
+            sink_(tasks);
+            tasks.clear();
+        }
+        return size;
+    }
+
+private:
+    std::vector<UTimerNode> nodes_;                                     // 预分配的定时节点
+    CUint slots_[WHEEL_LEVELS][WHEEL_SIZE] {};                          // 各层槽位的链表头
+    CUint free_head_ = NIL_NODE;                                        // 空闲节点链表头
+    std::atomic<CSize> size_ { 0 };                                     // 当前定时任务个数
+    CULong cur_tick_ = 0;                                               // 已经处理到的tick
+    CULong wait_tick_ = NIL_TICK;                                       // 定时线程等待到的tick
+    CMSec tick_ = DEFAULT_TIMER_TICK;                                   // 时间精度
+    CBool stop_ = true;
+    std::chrono::steady_clock::time_point start_;
+    UTimerSink sink_ = nullptr;                                         // 到期任务的接收函数
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+using UTimerWheelPtr = UTimerWheel *;
+
+#endif //UTIMERWHEEL_H
@@ -7,10 +7,14 @@
 
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <vector>
+#include <new>
 
 #include "./ThreadPoolinc.hpp"
 #include "./CFuncType.hpp"
 #include "./CStdEx.hpp"
+#include "./UtilsDefine.hpp"
 
 
 class CObject {
@@ -47,6 +51,270 @@ public:
 
 static std::mutex g_session_mtx;
 
+
+/**
+ * 内存池统计信息
+ */
+struct UArenaStats {
+    CSize arena_num_ = 0;                                        // arena个数，每个线程一个
+    CULong alloc_num_ = 0;                                       // 从arena中申请的次数
+    CULong free_num_ = 0;                                        // 本线程释放的次数
+    CULong remote_free_num_ = 0;                                 // 跨线程释放的次数
+    CULong large_alloc_num_ = 0;                                 // 超过最大规格，直接申请的次数
+    CSize chunk_bytes_ = 0;                                      // 从系统申请的内存总量
+};
+
+
+/**
+ * 线程级内存池。按照大小规格划分空闲链表，仅由所属线程申请
+ * 其他线程释放的内存，通过无锁链表归还给所属线程
+ * 线程退出后，arena会被新线程接管，内存不归还系统
+ */
+class UArena {
+    static const CSize HEADER_SIZE = 16;                         // 块头大小，同时保证16字节对齐
+    static const CSize MIN_CLASS_SIZE = 16;                      // 最小规格
+    static const CSize CLASS_NUM = 7;                            // 规格个数：16 ~ 1024
+    static const CSize MAX_CLASS_SIZE = MIN_CLASS_SIZE << (CLASS_NUM - 1);
+    static const CSize CHUNK_SIZE = 64 * 1024;                   // 每次从系统申请的大小
+
+    struct UBlockHeader {
+        UArena* owner_;                                          // 所属arena，为空表示直接从系统申请
+        CSize class_;                                            // 规格下标
+    };
+
+    struct UFreeNode {
+        UFreeNode* next_;
+    };
+
+    struct UArenaLocal {
+        UArena* arena_ = nullptr;
+        ~UArenaLocal() {
+            isExited() = true;
+            if (arena_) {
+                UArena::orphan(arena_);
+            }
+        }
+    };
+
+    struct UArenaRegistry {
+        std::mutex mutex_;
+        std::vector<UArena*> arenas_;                            // 所有的arena，用于统计
+        std::vector<UArena*> orphans_;                           // 所属线程已经退出的arena
+    };
+
+public:
+    /**
+     * 申请内存
+     * @param size
+     * @return
+     */
+    static void* malloc(CSize size) {
+        UArena* arena = (size <= MAX_CLASS_SIZE && !isExited()) ? local() : nullptr;
+        if (nullptr == arena) {
+            auto header = static_cast<UBlockHeader *>(::operator new(size + HEADER_SIZE));
+            header->owner_ = nullptr;
+            header->class_ = CLASS_NUM;
+            if (!isExited()) {
+                UArena* cur = local();
+                cur->large_alloc_num_.store(cur->large_alloc_num_.load(std::memory_order_relaxed) + 1,
+                                            std::memory_order_relaxed);
+            }
+            return reinterpret_cast<char *>(header) + HEADER_SIZE;
+        }
+
+        return arena->allocate(calcClass(size));
+    }
+
+    /**
+     * 释放内存，可以在任意线程中调用
+     * @param ptr
+     */
+    static CVoid free(void* ptr) {
+        if (nullptr == ptr) {
+            return;
+        }
+
+        auto header = reinterpret_cast<UBlockHeader *>(static_cast<char *>(ptr) - HEADER_SIZE);
+        UArena* owner = header->owner_;
+        if (nullptr == owner) {
+            ::operator delete(header);
+        } else if (!isExited() && owner == getLocal().arena_) {
+            owner->release(header);
+        } else {
+            owner->remoteRelease(header);
+        }
+    }
+
+    /**
+     * 汇总所有arena的统计信息
+     * @return
+     */
+    static UArenaStats stats() {
+        UArenaStats stats;
+        auto& registry = getRegistry();
+        LOCK_GUARD lk(registry.mutex_);
+        stats.arena_num_ = registry.arenas_.size();
+        for (auto* arena : registry.arenas_) {
+            stats.alloc_num_ += arena->alloc_num_.load(std::memory_order_relaxed);
+            stats.free_num_ += arena->free_num_.load(std::memory_order_relaxed);
+            stats.remote_free_num_ += arena->remote_free_num_.load(std::memory_order_relaxed);
+            stats.large_alloc_num_ += arena->large_alloc_num_.load(std::memory_order_relaxed);
+            stats.chunk_bytes_ += arena->chunk_bytes_.load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+
+    NO_ALLOWED_COPY(UArena)
+
+private:
+    explicit UArena() = default;
+
+    static CSize calcClass(CSize size) {
+        CSize cls = 0;
+        while ((MIN_CLASS_SIZE << cls) < size) {
+            cls++;
+        }
+        return cls;
+    }
+
+    void* allocate(CSize cls) {
+        UFreeNode* node = free_list_[cls];
+        if (nullptr == node) {
+            drainRemote();
+            node = free_list_[cls];
+        }
+
+        UBlockHeader* header = nullptr;
+        if (nullptr != node) {
+            free_list_[cls] = node->next_;
+            header = reinterpret_cast<UBlockHeader *>(reinterpret_cast<char *>(node) - HEADER_SIZE);
+        } else {
+            header = carve(cls);
+        }
+
+        header->owner_ = this;
+        header->class_ = cls;
+        alloc_num_.store(alloc_num_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return reinterpret_cast<char *>(header) + HEADER_SIZE;
+    }
+
+    /**
+     * 从当前chunk中切分一块内存，不足时申请新的chunk
+     * @param cls
+     * @return
+     */
+    UBlockHeader* carve(CSize cls) {
+        CSize size = HEADER_SIZE + (MIN_CLASS_SIZE << cls);
+        if (bump_ + size > bump_end_) {
+            bump_ = static_cast<char *>(::operator new(CHUNK_SIZE));
+            bump_end_ = bump_ + CHUNK_SIZE;
+            chunks_.push_back(bump_);
+            chunk_bytes_.store(chunk_bytes_.load(std::memory_order_relaxed) + CHUNK_SIZE,
+                               std::memory_order_relaxed);
+        }
+
+        auto header = reinterpret_cast<UBlockHeader *>(bump_);
+        bump_ += size;
+        return header;
+    }
+
+    CVoid release(UBlockHeader* header) {
+        auto node = reinterpret_cast<UFreeNode *>(reinterpret_cast<char *>(header) + HEADER_SIZE);
+        node->next_ = free_list_[header->class_];
+        free_list_[header->class_] = node;
+        free_num_.store(free_num_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    /**
+     * 其他线程归还内存，仅做入栈操作。出栈由所属线程整体取出，不存在ABA问题
+     * @param header
+     */
+    CVoid remoteRelease(UBlockHeader* header) {
+        auto node = reinterpret_cast<UFreeNode *>(reinterpret_cast<char *>(header) + HEADER_SIZE);
+        node->next_ = remote_head_.load(std::memory_order_relaxed);
+        while (!remote_head_.compare_exchange_weak(node->next_, node,
+                                                   std::memory_order_release,
+                                                   std::memory_order_relaxed)) {
+        }
+        remote_free_num_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    CVoid drainRemote() {
+        if (nullptr == remote_head_.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        UFreeNode* node = remote_head_.exchange(nullptr, std::memory_order_acquire);
+        while (nullptr != node) {
+            UFreeNode* next = node->next_;
+            auto header = reinterpret_cast<UBlockHeader *>(reinterpret_cast<char *>(node) - HEADER_SIZE);
+            node->next_ = free_list_[header->class_];
+            free_list_[header->class_] = node;
+            node = next;
+        }
+    }
+
+    static CBool& isExited() {
+        static thread_local CBool exited = false;                // 当前线程的arena是否已经释放
+        return exited;
+    }
+
+    static UArenaLocal& getLocal() {
+        static thread_local UArenaLocal holder;
+        return holder;
+    }
+
+    static UArena* local() {
+        auto& holder = getLocal();
+        if (unlikely(nullptr == holder.arena_)) {
+            holder.arena_ = adopt();
+        }
+        return holder.arena_;
+    }
+
+    static UArenaRegistry& getRegistry() {
+        static auto* registry = new UArenaRegistry();            // 不析构，保证在静态对象析构阶段依然可用
+        return *registry;
+    }
+
+    /**
+     * 优先接管已经退出线程的arena
+     * @return
+     */
+    static UArena* adopt() {
+        auto& registry = getRegistry();
+        LOCK_GUARD lk(registry.mutex_);
+        if (!registry.orphans_.empty()) {
+            UArena* arena = registry.orphans_.back();
+            registry.orphans_.pop_back();
+            return arena;
+        }
+
+        auto arena = new UArena();
+        registry.arenas_.push_back(arena);
+        return arena;
+    }
+
+    static CVoid orphan(UArena* arena) {
+        auto& registry = getRegistry();
+        LOCK_GUARD lk(registry.mutex_);
+        registry.orphans_.push_back(arena);
+    }
+
+private:
+    UFreeNode* free_list_[CLASS_NUM] {};                         // 各规格的空闲链表，仅所属线程访问
+    char* bump_ = nullptr;                                       // 当前chunk中未切分的起始位置
+    char* bump_end_ = nullptr;
+    std::vector<char *> chunks_;                                 // 申请的所有chunk
+    std::atomic<UFreeNode *> remote_head_ { nullptr };           // 其他线程归还的内存
+
+    std::atomic<CULong> alloc_num_ { 0 };
+    std::atomic<CULong> free_num_ { 0 };
+    std::atomic<CULong> remote_free_num_ { 0 };
+    std::atomic<CULong> large_alloc_num_ { 0 };
+    std::atomic<CSize> chunk_bytes_ { 0 };
+};
+
 /**
  * 仅用于生成CObject类型的类
  */
@@ -95,6 +363,66 @@ class UAllocator : public CObject {
     static std::unique_ptr<T> makeUniqueCObject() {
         return c_make_unique<T>();
     }
+
+    /**
+     * 从当前线程的arena中申请内存
+     * @param size
+     * @return
+     */
+    static void* arenaMalloc(CSize size) {
+        return UArena::malloc(size);
+    }
+
+    /**
+     * 释放arena中申请的内存，可以在任意线程中调用
+     * @param ptr
+     */
+    static CVoid arenaFree(void* ptr) {
+        UArena::free(ptr);
+    }
+
+    /**
+     * 获取arena统计信息
+     * @return
+     */
+    static UArenaStats getArenaStats() {
+        return UArena::stats();
+    }
+};
+
+
+/**
+ * 基于arena的stl分配器，用于队列节点和future状态等
+ * @tparam T
+ */
+template<typename T>
+class UArenaAllocator {
+public:
+    using value_type = T;
+
+    UArenaAllocator() noexcept = default;
+
+    template<typename U>
+    UArenaAllocator(const UArenaAllocator<U>&) noexcept {}
+
+    T* allocate(CSize n) {
+        static_assert(alignof(T) <= 16, "arena only supports 16 bytes alignment");
+        return static_cast<T *>(UAllocator::arenaMalloc(n * sizeof(T)));
+    }
+
+    CVoid deallocate(T* ptr, CSize) noexcept {
+        UAllocator::arenaFree(ptr);
+    }
+
+    template<typename U>
+    CBool operator==(const UArenaAllocator<U>&) const noexcept {
+        return true;
+    }
+
+    template<typename U>
+    CBool operator!=(const UArenaAllocator<U>&) const noexcept {
+        return false;
+    }
 };
 
 #define SAFE_MALLOC_COBJECT(Type) UAllocator::safeMallocCObject<Type>();
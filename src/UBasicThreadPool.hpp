@@ -0,0 +1,320 @@
+/***************************
+@File: UBasicThreadPool.h
+@Desc: 编译期配置的精简线程池。队列类型、批量大小、窃取范围、空闲策略和统计开关
+       均由 Traits 在编译期决定，工作线程的循环中没有虚函数和配置分支，可以完全内联
+       不支持辅助线程、优先级、通道、定时等功能，需要这些功能时使用 UThreadPool
+       UThreadPool 并不是本模板的别名：它的功能均在运行时配置（可以继承并重写 dispatch()），
+       仍按照 UThreadPoolConfig 在运行时选择执行路径。本模板是与之并列的独立实现，二者不共享工作线程
+***************************/
+
+#ifndef UBASICTHREADPOOL_H
+#define UBASICTHREADPOOL_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+#include "./ThreadPoolinc.hpp"
+#include "./CFuncType.hpp"
+#include "./UtilsDefine.hpp"
+#include "./Queue/UQueueInclude.hpp"
+#include "./Task/UTask.hpp"
+#include "./Task/UFutureTask.hpp"
+#include "./Task/UTaskHooks.hpp"
+
+/**
+ * 空闲策略：直接让出cpu，响应最快
+ */
+struct UYieldIdlePolicy {
+    CVoid idle() {
+        std::this_thread::yield();
+    }
+
+    CVoid reset() {}
+};
+
+
+/**
+ * 空闲策略：连续空闲一段时间后休眠，降低cpu占用
+ * @tparam SPIN_TIMES 开始休眠前，让出cpu的次数
+ * @tparam SLEEP_US 每次休眠的时间，单位为us
+ */
+template<int SPIN_TIMES = 1024, int SLEEP_US = 100>
+struct USleepIdlePolicy {
+    CVoid idle() {
+        if (times_ < SPIN_TIMES) {
+            times_++;
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(SLEEP_US));
+        }
+    }
+
+    CVoid reset() {
+        times_ = 0;
+    }
+
+private:
+    int times_ = 0;
+};
+
+
+/**
+ * 默认配置，自定义时继承并覆盖需要修改的部分即可
+ */
+struct UBasicThreadPoolTraits {
+    static const int THREAD_SIZE = DEFAULT_THREAD_SIZE;         // 默认工作线程个数
+    static const int BATCH_SIZE = 1;                             // 每次从本地队列获取的任务个数，为1时逐个获取
+    static const int STEAL_RANGE = MAX_TASK_STEAL_RANGE;         // 窃取相邻线程的个数，为0时不窃取
+    static const bool STATS_ENABLE = false;                      // 是否统计执行和窃取的任务个数
+    using IdlePolicy = UYieldIdlePolicy;                         // 空闲策略
+    using LocalQueue = UWorkStealingQueue;                       // 工作线程的队列，需要支持 push/tryPop/trySteal
+};
+
+
+/**
+ * 线程池统计信息，仅在 STATS_ENABLE 时有效
+ */
+struct UBasicThreadPoolStats {
+    CULong run_num_ = 0;                                         // 执行的任务个数
+    CULong steal_num_ = 0;                                       // 窃取的任务个数
+};
+
+
+template<typename Traits = UBasicThreadPoolTraits>
+class UBasicThreadPool {
+    using BatchType = std::integral_constant<bool, (Traits::BATCH_SIZE > 1)>;
+    using StatsType = std::integral_constant<bool, Traits::STATS_ENABLE>;
+
+    struct alignas(64) UWorker {
+        typename Traits::LocalQueue queue_;
+        typename Traits::IdlePolicy idle_;
+        UTaskArr batch_tasks_;                                   // 批量任务的缓存，循环复用
+        std::thread thread_;
+        std::atomic<CULong> run_num_ { 0 };
+        std::atomic<CULong> steal_num_ { 0 };
+    };
+
+public:
+    /**
+     * 创建线程池
+     * @param threadSize 工作线程个数
+     * @param autoInit 是否自动开启线程池功能
+     */
+    explicit UBasicThreadPool(int threadSize = Traits::THREAD_SIZE,
+                              CBool autoInit = true) {
+        thread_size_ = std::max(threadSize, 1);
+        if (autoInit) {
+            init();
+        }
+    }
+
+    ~UBasicThreadPool() {
+        destroy();
+    }
+
+    /**
+     * 开启所有的工作线程
+     * @return
+     */
+    CStatus init() {
+        FUNCTION_BEGIN
+        if (is_init_) {
+            FUNCTION_END
+        }
+
+        done_.store(true, std::memory_order_release);
+        workers_.clear();
+        for (int i = 0; i < thread_size_; i++) {
+            workers_.emplace_back(new UWorker());
+        }
+        for (int i = 0; i < thread_size_; i++) {
+            workers_[i]->thread_ = std::thread(&UBasicThreadPool::run, this, i);
+        }
+        is_init_ = true;
+        FUNCTION_END
+    }
+
+    /**
+     * 停止所有的工作线程，未执行的任务直接丢弃
+     * @return
+     */
+    CStatus destroy() {
+        FUNCTION_BEGIN
+        if (!is_init_) {
+            FUNCTION_END
+        }
+
+        done_.store(false, std::memory_order_release);
+        for (auto& worker : workers_) {
+            if (worker->thread_.joinable()) {
+                worker->thread_.join();
+            }
+        }
+        workers_.clear();
+        is_init_ = false;
+        FUNCTION_END
+    }
+
+    /**
+     * 提交任务。在工作线程中提交时，直接写入本线程的队列
+     * @tparam FunctionType
+     * @param func
+     * @param index 指定工作线程，DEFAULT_TASK_STRATEGY 表示自动选择
+     * @return
+     */
+    template<typename FunctionType>
+    auto commit(const FunctionType& func,
+                CIndex index = DEFAULT_TASK_STRATEGY)
+    -> std::future<typename std::result_of<FunctionType()>::type> {
+        using ResultType = typename std::result_of<FunctionType()>::type;
+
+        UFutureTask<FunctionType, ResultType> futureTask(func);
+        std::future<ResultType> result(futureTask.getFuture());
+
+        if (!is_init_) {
+            return result;    // 未初始化时任务被丢弃，future中返回 broken_promise
+        }
+
+        UTask task(std::move(futureTask));
+        UTaskHooks::onEnqueue(task.getHookContext());
+        UCurrentWorker* self = current();
+        if (index >= 0 && index < thread_size_) {
+            workers_[index]->queue_.push(std::move(task));
+        } else if (nullptr != self && self->owner_ == this) {
+            self->worker_->queue_.push(std::move(task));
+        } else {
+            CSize cur = cur_index_.fetch_add(1, std::memory_order_relaxed);
+            workers_[cur % thread_size_]->queue_.push(std::move(task));
+        }
+        return result;
+    }
+
+    /**
+     * 获取统计信息，未开启 STATS_ENABLE 时均为0
+     * @return
+     */
+    UBasicThreadPoolStats getStats() const {
+        UBasicThreadPoolStats stats;
+        for (auto& worker : workers_) {
+            stats.run_num_ += worker->run_num_.load(std::memory_order_relaxed);
+            stats.steal_num_ += worker->steal_num_.load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+
+    [[nodiscard]] int getThreadSize() const {
+        return thread_size_;
+    }
+
+    NO_ALLOWED_COPY(UBasicThreadPool)
+
+private:
+    /**
+     * 当前线程所属的线程池和工作线程
+     */
+    struct UCurrentWorker {
+        UBasicThreadPool* owner_ = nullptr;
+        UWorker* worker_ = nullptr;
+    };
+
+    static UCurrentWorker*& current() {
+        static thread_local UCurrentWorker* cur = nullptr;
+        return cur;
+    }
+
+    /**
+     * 工作线程执行函数
+     * @param index
+     */
+    CVoid run(int index) {
+        UCurrentWorker self { this, workers_[index].get() };
+        current() = &self;
+        UWorker& worker = *workers_[index];
+        while (done_.load(std::memory_order_acquire)) {
+            if (process(index, worker, BatchType())) {
+                worker.idle_.reset();
+            } else {
+                UTaskHooks::onIdle(index);
+                worker.idle_.idle();
+            }
+        }
+        current() = nullptr;
+    }
+
+    /**
+     * 逐个获取并执行任务
+     * @return 是否执行了任务
+     */
+    CBool process(int index, UWorker& worker, std::false_type) {
+        UTask task;
+        if (!worker.queue_.tryPop(task) && !steal(index, worker, task)) {
+            return false;
+        }
+
+        UTaskHooks::beforeRun(task.getHookContext());
+        task();
+        UTaskHooks::afterRun(task.getHookContext());
+        count(worker.run_num_, 1, StatsType());
+        return true;
+    }
+
+    /**
+     * 批量获取并执行任务
+     * @return 是否执行了任务
+     */
+    CBool process(int index, UWorker& worker, std::true_type) {
+        UTaskArrRef tasks = worker.batch_tasks_;
+        if (!worker.queue_.tryPop(tasks, Traits::BATCH_SIZE)) {
+            UTask task;
+            if (!steal(index, worker, task)) {
+                return false;
+            }
+            tasks.emplace_back(std::move(task));
+        }
+
+        for (auto& task : tasks) {
+            UTaskHooks::beforeRun(task.getHookContext());
+            task();
+            UTaskHooks::afterRun(task.getHookContext());
+        }
+        count(worker.run_num_, tasks.size(), StatsType());
+        tasks.clear();
+        return true;
+    }
+
+    /**
+     * 从相邻的工作线程中窃取一个任务
+     * @return
+     */
+    CBool steal(int index, UWorker& worker, UTaskRef task) {
+        const int range = std::min(Traits::STEAL_RANGE, thread_size_ - 1);
+        for (int i = 0; i < range; i++) {
+            int victim = (index + i + 1) % thread_size_;
+            if (workers_[victim]->queue_.trySteal(task)) {
+                UTaskHooks::onSteal(victim, 1);
+                count(worker.steal_num_, 1, StatsType());
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static CVoid count(std::atomic<CULong>& counter, CSize size, std::true_type) {
+        counter.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    static CVoid count(std::atomic<CULong>&, CSize, std::false_type) {}
+
+private:
+    int thread_size_ = 0;                                        // 工作线程个数
+    CBool is_init_ = false;
+    std::atomic<bool> done_ { false };                           // 工作线程运行标记
+    std::atomic<CSize> cur_index_ { 0 };                         // 轮询写入的下标
+    std::vector<std::unique_ptr<UWorker>> workers_;
+};
+
+#endif //UBASICTHREADPOOL_H
@@ -13,7 +13,6 @@ UThreadPool::UThreadPool(CBool autoInit, const UThreadPoolConfig& config) noexce
     input_task_num_ = 0;
     this->setConfig(config);    // setConfig 函数，用在 is_init_ 设定之后
     is_monitor_ = config_.monitor_enable_;        /** 根据参数设定，决定是否开启监控线程。默认开启 */
-    monitor_thread_ = std::move(std::thread(&UThreadPool::monitor, this));
     if (autoInit) {
         this->init();
     }
@@ -21,7 +20,12 @@ UThreadPool::UThreadPool(CBool autoInit, const UThreadPoolConfig& config) noexce
 
 
 UThreadPool::~UThreadPool() {
-    is_monitor_ = false;    // 在析构的时候，才释放监控线程。先释放监控线程，再释放其他的线程
+    {
+        // 在析构的时候，才释放监控线程。先释放监控线程，再释放其他的线程
+        LOCK_GUARD lk(monitor_mutex_);
+        is_monitor_ = false;
+    }
+    monitor_cv_.notify_all();
     if (monitor_thread_.joinable()) {
         monitor_thread_.join();
     }
@@ -45,17 +49,60 @@ CStatus UThreadPool::init() {
         FUNCTION_END
     }
 
-    thread_record_map_.clear();
-    primary_threads_.reserve(config_.default_thread_size_); // 因为这里存储主线程的vector大小是固定的，所以直接预分配内存
-    for (int i = 0; i < config_.default_thread_size_; i++) {
-        auto ptr = SAFE_MALLOC_COBJECT(UThreadPrimary);    // 创建核心线程数
-        ptr->setThreadPoolInfo(i, &task_queue_, &primary_threads_, &config_);
-        status += ptr->init();
+    // 设置队列容量和水位信息
+    task_queue_.setCapacity(config_.pool_queue_capacity_)
+        ->setWatermark(DEFAULT_TASK_STRATEGY,
+                       UThreadPoolConfig::calcWatermark(config_.pool_queue_capacity_, config_.queue_high_watermark_),
+                       UThreadPoolConfig::calcWatermark(config_.pool_queue_capacity_, config_.queue_low_watermark_),
+                       config_.on_high_watermark_, config_.on_low_watermark_);
+
+    // 到期的定时任务，批量放入主线程的队列中
+    status = timer_wheel_.init(config_.timer_tick_, config_.timer_capacity_,
+                               [this](UTaskArrRef tasks) {
+                                   deliverTimerTasks(tasks);
+                               });
+    FUNCTION_CHECK_STATUS
+
+    if (config_.reactor_enable_) {
+        status = reactor_.init();
+        FUNCTION_CHECK_STATUS
+    }
 
-        // 记录线程和匹配id信息
-        thread_record_map_[(CSize)std::hash<std::thread::id>{}(ptr->thread_.get_id())] = i;
+    {
+        LOCK_GUARD lk(thread_record_mutex_);
+        thread_record_map_.clear();
+    }
+
+    /**
+     * 按照可扩容的上限，一次性创建所有主线程对象，之后槽位不再变化
+     * 仅启动前 default_thread_size_ 个，其余的在 resizePrimary() 时启动
+     */
+    int slotSize = config_.calcPrimarySlotSize();
+    primary_threads_.reserve(slotSize);
+    UTimerWheelPtr timerWheel = config_.timer_by_idle_worker_ ? &timer_wheel_ : nullptr;
+    UReactorPtr reactor = config_.reactor_enable_ ? &reactor_ : nullptr;
+    idle_bitmap_.init(slotSize);
+    for (int i = 0; i < slotSize; i++) {
+        auto ptr = SAFE_MALLOC_COBJECT(UThreadPrimary);
+        ptr->setThreadPoolInfo(i, &task_queue_, &primary_threads_, &cur_primary_size_, &config_, timerWheel, reactor);
+        ptr->setLaneInfo(&lane_ptrs_, nullptr);
+        ptr->setIdleInfo(config_.mailbox_enable_ ? &idle_bitmap_ : nullptr);
+        ptr->setQuiescence(&quiescence_);
+        ptr->work_stealing_queue_.setCapacity(config_.primary_queue_capacity_)
+            ->setWatermark(i,
+                           UThreadPoolConfig::calcWatermark(config_.primary_queue_capacity_, config_.queue_high_watermark_),
+                           UThreadPoolConfig::calcWatermark(config_.primary_queue_capacity_, config_.queue_low_watermark_),
+                           config_.on_high_watermark_, config_.on_low_watermark_);
         primary_threads_.emplace_back(ptr);
     }
+
+    // 各线程启动后自行设置调度参数和亲和性，这里只负责创建。延迟启动时仅创建一个
+    int startSize = config_.lazy_primary_enable_ ? 1 : config_.default_thread_size_;
+    for (int i = 0; i < startSize; i++) {
+        status += startPrimary(i);    // 创建核心线程数
+    }
+    target_primary_size_.store(config_.default_thread_size_, std::memory_order_relaxed);
+    cur_primary_size_.store(startSize, std::memory_order_release);
     FUNCTION_CHECK_STATUS
 
     /**
@@ -66,7 +113,30 @@ CStatus UThreadPool::init() {
     status = createSecondaryThread(config_.secondary_thread_size_);
     FUNCTION_CHECK_STATUS
 
+    // 启动通道的专属线程
+    for (auto& lane : lanes_) {
+        for (int i = 0; i < lane->getReservedSize(); i++) {
+            auto ptr = MAKE_UNIQUE_COBJECT(UThreadSecondary)
+            ptr->setThreadPoolInfo(&task_queue_, &priority_task_queue_, &config_);
+            ptr->setLaneInfo(&lane_ptrs_, lane.get());
+            ptr->setQuiescence(&quiescence_);
+            status += ptr->init();
+            lane_threads_.emplace_back(std::move(ptr));
+        }
+    }
+    FUNCTION_CHECK_STATUS
+
+    if (!config_.timer_by_idle_worker_) {
+        // 没有定时任务的时候，定时线程处于等待状态
+        timer_thread_ = std::thread(&UTimerWheel::loop, &timer_wheel_);
+    }
+
     is_init_ = true;
+    if (config_.monitor_enable_ && !monitor_thread_.joinable()) {
+        // 不开启监控时，不创建监控线程
+        is_monitor_ = true;
+        monitor_thread_ = std::thread(&UThreadPool::monitor, this);
+    }
     FUNCTION_END
 }
 
@@ -76,8 +146,12 @@ CStatus UThreadPool::submit(const UTaskGroup& taskGroup, CMSec ttl) {
     ASSERT_INIT(true)
 
     std::vector<std::future<CVoid>> futures;
+    futures.reserve(taskGroup.task_arr_.size());
     for (const auto& task : taskGroup.task_arr_) {
-        futures.emplace_back(commit(task));
+        // 共享同一个token，整组取消只需修改一次标记
+        futures.emplace_back(taskGroup.token_
+                             ? commit(task, *taskGroup.token_)
+                             : commit(task));
     }
 
     // 计算最终运行时间信息
@@ -102,14 +176,434 @@ CStatus UThreadPool::submit(const UTaskGroup& taskGroup, CMSec ttl) {
 }
 
 
+CStatus UThreadPool::submitAsync(const UTaskGroup& taskGroup, CMSec ttl) {
+    FUNCTION_BEGIN
+    ASSERT_INIT(true)
+
+    std::vector<UFuture<CVoid>> futures;
+    futures.reserve(taskGroup.task_arr_.size());
+    for (const auto& task : taskGroup.task_arr_) {
+        if (taskGroup.token_) {
+            // 被取消的任务直接跳过，与 submit() 一致，不影响执行结果
+            UCancellationToken token = *taskGroup.token_;
+            futures.emplace_back(commitAsync([token, task] {
+                if (!token.isCancelled()) {
+                    task();
+                }
+            }));
+        } else {
+            futures.emplace_back(commitAsync(task));
+        }
+    }
+
+    struct USubmitContext {
+        std::atomic<CBool> finished_ { false };                  // on_finished_ 是否已经执行
+        std::atomic<UTimerId> timer_ { 0 };                      // 超时检测的定时任务
+        CALLBACK_FUNCTION on_finished_ = nullptr;
+    };
+    auto context = std::make_shared<USubmitContext>();
+    context->on_finished_ = taskGroup.on_finished_;
+
+    CMSec realTtl = std::min(taskGroup.getTtl(), ttl);
+    if (realTtl < MAX_BLOCK_TTL) {
+        context->timer_ = commitAfter([context] {
+            if (!context->finished_.exchange(true) && context->on_finished_) {
+                context->on_finished_(CStatus("thread status timeout"));
+            }
+        }, realTtl);
+    }
+
+    whenAll(std::move(futures)).then([this, context](std::vector<UFuture<CVoid>>) {
+        if (context->finished_.exchange(true)) {
+            return;
+        }
+
+        UTimerId timer = context->timer_.load();
+        if (0 != timer) {
+            cancelTimer(timer);
+        }
+        if (context->on_finished_) {
+            context->on_finished_(CStatus());
+        }
+    }, true);
+    FUNCTION_END
+}
+
+
 CStatus UThreadPool::submit(DEFAULT_CONST_FUNCTION_REF func, CMSec ttl,
                             CALLBACK_CONST_FUNCTION_REF onFinished) {
     return submit(UTaskGroup(func, ttl, onFinished));
 }
 
 
+UTimerId UThreadPool::commitAfter(DEFAULT_CONST_FUNCTION_REF func, CMSec delay) {
+    return timer_wheel_.add(func, delay);
+}
+
+
+UTimerId UThreadPool::commitEvery(DEFAULT_CONST_FUNCTION_REF func, CMSec interval) {
+    if (interval <= 0) {
+        return 0;
+    }
+    return timer_wheel_.add(func, interval, interval);
+}
+
+
+CBool UThreadPool::cancelTimer(UTimerId id) {
+    return timer_wheel_.cancel(id);
+}
+
+
+CVoid UThreadPool::deliverTimerTasks(UTaskArrRef tasks) {
+    quiescence_.add((CLong)tasks.size());
+
+    // 空闲的主线程推进时间轮时，放入本线程的队列；定时线程推进时，按默认策略选择主线程
+    UThreadPrimaryPtr primary = UThreadPrimary::current();
+    CIndex index = (nullptr != primary && primary->pool_threads_ == &primary_threads_)
+                   ? dispatch(primary->index_) : dispatch(DEFAULT_TASK_STRATEGY);
+    if (index >= cur_primary_size_.load(std::memory_order_acquire)) {
+        index = DEFAULT_TASK_STRATEGY;
+    }
+
+    CSize capacity = (DEFAULT_TASK_STRATEGY == index) ? config_.pool_queue_capacity_ : config_.primary_queue_capacity_;
+    if (0 == capacity) {
+        // 不限制容量时，整批写入，只加锁一次
+        if (DEFAULT_TASK_STRATEGY == index) {
+            task_queue_.push(tasks);
+        } else {
+            primary_threads_[index]->work_stealing_queue_.push(tasks);
+        }
+        return;
+    }
+
+    for (auto& task : tasks) {
+        CBool result = (DEFAULT_TASK_STRATEGY == index)
+                       ? task_queue_.tryPush(std::move(task))
+                       : primary_threads_[index]->work_stealing_queue_.tryPush(std::move(task));
+        if (!result && overflow(std::move(task), index).isErr()) {
+            quiescence_.done();    // 被拒绝的任务不会执行
+        }
+    }
+    tasks.clear();
+}
+
+
+ULanePtr UThreadPool::createLane(const std::string& name, CUint weight, int reservedSize) {
+    ASSERT_INIT_RETURN_NULL(false)    // 线程运行时会遍历通道信息，所以仅在init之前创建
+
+    lanes_.emplace_back(c_make_unique<ULane>(name, weight, reservedSize));
+    lane_ptrs_.emplace_back(lanes_.back().get());
+    return lanes_.back().get();
+}
+
+
+CStatus UThreadPool::waitIdle(CMSec ttl) {
+    FUNCTION_BEGIN
+    ASSERT_INIT(true)
+
+    if (!quiescence_.waitIdle(ttl)) {
+        RETURN_ERROR_STATUS("wait idle timeout")
+    }
+    FUNCTION_END
+}
+
+
+CVoid UThreadPool::pause() {
+    quiescence_.pause();
+}
+
+
+CVoid UThreadPool::resume() {
+    quiescence_.resume();
+}
+
+
+CBool UThreadPool::yieldPoint() {
+    UThreadPrimaryPtr primary = UThreadPrimary::current();
+    if (nullptr == primary || primary->pool_threads_ != &primary_threads_
+        || primary->blocking_depth_ > 0) {
+        return false;    // 非本线程池的主线程，或者队列已由补偿线程接管
+    }
+    if (quiescence_.isPaused()) {
+        return false;    // 暂停期间不获取任务，当前任务继续执行
+    }
+
+    // 信箱和收件队列中的任务同样在等待，一并转入本地队列
+    UTask task;
+    if (primary->mailbox_.tryTake(task)) {
+        primary->work_stealing_queue_.push(std::move(task));
+    }
+    primary->drainInbox();
+    CSize size = primary->work_stealing_queue_.size();
+    if (0 == size) {
+        return false;
+    }
+
+    if (primary->yield_depth_ >= MAX_YIELD_POINT_DEPTH) {
+        // 嵌套过深时，继续执行会使外层任务的栈持续增长，交给其他线程执行
+        UTaskArr tasks;
+        if (!primary->work_stealing_queue_.trySteal(tasks, (int)size)) {
+            return false;
+        }
+        task_queue_.push(tasks);
+        return true;
+    }
+
+    if (!primary->popTask(task)) {
+        return false;    // 已被其他线程窃取
+    }
+    primary->yield_depth_++;
+    primary->runTask(task);
+    primary->yield_depth_--;
+    return true;
+}
+
+
+CStatus UThreadPool::resizePrimary(int size) {
+    FUNCTION_BEGIN
+    ASSERT_INIT(true)
+    if (size <= 0 || size > (int)primary_threads_.size()) {
+        RETURN_ERROR_STATUS("primary thread size is out of range")
+    }
+
+    LOCK_GUARD lk(resize_mutex_);
+    target_primary_size_.store(size, std::memory_order_relaxed);
+    int curSize = cur_primary_size_.load(std::memory_order_acquire);
+    if (size > curSize) {
+        // 先启动线程，再对外生效，新线程在生效前只会窃取已有线程的任务
+        for (int i = curSize; i < size; i++) {
+            status += startPrimary(i);
+        }
+        FUNCTION_CHECK_STATUS
+        cur_primary_size_.store(size, std::memory_order_release);
+    } else if (size < curSize) {
+        // 先对外失效，新任务不再写入被回收的线程；正在执行的任务，会在执行完成后退出
+        cur_primary_size_.store(size, std::memory_order_release);
+        for (int i = size; i < curSize; i++) {
+            status += stopPrimary(i);
+        }
+        FUNCTION_CHECK_STATUS
+
+        // 将剩余任务依次分给生效的线程。并发写入的少量任务，由空闲线程从回收的线程中窃取
+        int target = 0;
+        UTask task;
+        for (int i = size; i < curSize; i++) {
+            auto& queue = primary_threads_[i]->work_stealing_queue_;
+            while (queue.size() > 0) {
+                if (queue.tryPop(task)) {
+                    primary_threads_[target]->work_stealing_queue_.push(std::move(task));
+                    target = (target + 1) % size;
+                } else {
+                    std::this_thread::yield();    // 被其他线程窃取中
+                }
+            }
+        }
+    }
+
+    FUNCTION_END
+}
+
+
+int UThreadPool::getPrimarySize() const {
+    return cur_primary_size_.load(std::memory_order_acquire);
+}
+
+
+UThreadSecondaryPtr UThreadPool::acquireCompensate(UThreadPrimaryPtr primary) {
+    UThreadSecondaryPtr thread = nullptr;
+    {
+        LOCK_GUARD lk(compensate_mutex_);
+        if (!is_init_) {
+            return nullptr;
+        }
+
+        if (!parked_threads_.empty()) {
+            thread = parked_threads_.back();
+            parked_threads_.pop_back();
+        } else if ((int)compensate_threads_.size() < config_.max_compensate_thread_size_) {
+            auto ptr = MAKE_UNIQUE_COBJECT(UThreadSecondary)
+            ptr->setThreadPoolInfo(&task_queue_, &priority_task_queue_, &config_);
+            ptr->setCompensate();
+            ptr->setQuiescence(&quiescence_);
+            if (ptr->init().isErr()) {
+                return nullptr;
+            }
+            thread = ptr.get();
+            compensate_threads_.emplace_back(std::move(ptr));
+        }
+    }
+
+    if (nullptr != thread) {
+        thread->adopt(primary);
+    }
+    return thread;
+}
+
+
+CVoid UThreadPool::releaseCompensate(UThreadSecondaryPtr thread) {
+    thread->adopt(nullptr);
+    LOCK_GUARD lk(compensate_mutex_);
+    parked_threads_.emplace_back(thread);
+}
+
+
+UThreadPool::BlockingScope::BlockingScope(UThreadPool* pool) {
+    UThreadPrimaryPtr primary = UThreadPrimary::current();
+    if (nullptr == pool || nullptr == primary
+        || primary->pool_threads_ != &pool->primary_threads_) {
+        return;    // 非本线程池的主线程，不做处理
+    }
+
+    primary_ = primary;
+    if (0 != primary->blocking_depth_++) {
+        return;    // 嵌套的阻塞区域，仅由最外层接管队列
+    }
+
+    // 信箱和收件队列中的任务转入队列，由补偿线程一并接管
+    UTask task;
+    if (primary->mailbox_.tryTake(task)) {
+        primary->work_stealing_queue_.push(std::move(task));
+    }
+    while (primary->drainInbox() > 0) {
+    }
+
+    pool_ = pool;
+    compensate_ = pool->acquireCompensate(primary);
+}
+
+
+UThreadPool::BlockingScope::~BlockingScope() {
+    if (nullptr == primary_) {
+        return;
+    }
+
+    primary_->blocking_depth_--;
+    if (nullptr != compensate_) {
+        pool_->releaseCompensate(compensate_);
+    }
+}
+
+
+UThreadPool::TaskScope::TaskScope(UThreadPool* pool) {
+    pool_ = pool;
+    UThreadPrimaryPtr primary = UThreadPrimary::current();
+    if (nullptr != pool && nullptr != primary
+        && primary->pool_threads_ == &pool->primary_threads_) {
+        primary_ = primary;
+    }
+}
+
+
+UThreadPool::TaskScope::~TaskScope() {
+    wait();    // 析构时不抛出异常，需要异常信息时显式调用sync()
+}
+
+
+CVoid UThreadPool::TaskScope::sync() {
+    wait();
+    if (has_exception_.load(std::memory_order_acquire)) {
+        auto ptr = exception_;
+        exception_ = nullptr;
+        has_exception_.store(false, std::memory_order_relaxed);
+        std::rethrow_exception(ptr);
+    }
+}
+
+
+CVoid UThreadPool::TaskScope::wait() {
+    while (pending_.load(std::memory_order_acquire) > 0) {
+        UTask task;
+        if (nullptr != primary_) {
+            primary_->checkPause();    // 暂停期间不获取任务，与工作线程的主循环保持一致
+        }
+        if (nullptr != primary_ && (primary_->popTask(task) || primary_->stealTask(task))) {
+            // 先执行本地最新写入的子任务，本地没有时说明子任务已被窃取，帮助其他线程执行
+            primary_->runTask(task);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+
+CVoid UThreadPool::TaskScope::setException(std::exception_ptr ptr) {
+    if (!has_exception_.exchange(true, std::memory_order_acq_rel)) {
+        exception_ = ptr;
+    }
+}
+
+
+CVoid UThreadPool::growPrimary() {
+    if (likely(!config_.lazy_primary_enable_)) {
+        return;    // resizePrimary() 过程中也会出现未达到目标个数的情况，不需要处理
+    }
+
+    int size = cur_primary_size_.load(std::memory_order_acquire);
+    if (size >= target_primary_size_.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    auto end = primary_threads_.begin() + size;
+    if (std::any_of(primary_threads_.begin(), end, [](UThreadPrimaryPtr ptr) {
+        return !ptr->is_running_ && 0 == ptr->getLoad();
+    })) {
+        return;    // 还有空闲且没有积压任务的主线程
+    }
+
+    std::unique_lock<std::mutex> lk(resize_mutex_, std::try_to_lock);
+    if (!lk.owns_lock()) {
+        return;
+    }
+
+    size = cur_primary_size_.load(std::memory_order_acquire);
+    if (size < target_primary_size_.load(std::memory_order_relaxed) && startPrimary(size).isOK()) {
+        cur_primary_size_.store(size + 1, std::memory_order_release);
+    }
+}
+
+
+CStatus UThreadPool::startPrimary(int index) {
+    FUNCTION_BEGIN
+    auto ptr = primary_threads_[index];
+    status = ptr->init();
+    FUNCTION_CHECK_STATUS
+
+    // 记录线程和匹配id信息
+    LOCK_GUARD lk(thread_record_mutex_);
+    thread_record_map_[(CSize)std::hash<std::thread::id>{}(ptr->thread_.get_id())] = index;
+    FUNCTION_END
+}
+
+
+CStatus UThreadPool::stopPrimary(int index) {
+    FUNCTION_BEGIN
+    auto ptr = primary_threads_[index];
+    {
+        LOCK_GUARD lk(thread_record_mutex_);
+        thread_record_map_.erase((CSize)std::hash<std::thread::id>{}(ptr->thread_.get_id()));
+    }
+    status = ptr->destroy();
+
+    // 不再接收直接投递，信箱和收件队列中残留的任务转入队列，由其他线程窃取
+    UTask task;
+    idle_bitmap_.reset(index);
+    if (ptr->mailbox_.close(task)) {
+        ptr->work_stealing_queue_.push(std::move(task));
+    }
+    while (ptr->drainInbox() > 0) {
+    }
+    FUNCTION_END
+}
+
+
+UReactorPtr UThreadPool::getReactor() {
+    return (is_init_ && config_.reactor_enable_) ? &reactor_ : nullptr;
+}
+
+
 CIndex UThreadPool::getThreadNum(CSize tid) {
     int threadNum = SECONDARY_THREAD_COMMON_ID;
+    LOCK_GUARD lk(thread_record_mutex_);
     auto result = thread_record_map_.find(tid);
     if (result != thread_record_map_.end()) {
         threadNum = result->second;
@@ -125,21 +619,81 @@ CStatus UThreadPool::destroy() {
         FUNCTION_END
     }
 
-    // primary 线程是普通指针，需要delete
+    // 先停止时间轮，未到期的定时任务直接丢弃
+    status = timer_wheel_.destroy();
+    if (timer_thread_.joinable()) {
+        timer_thread_.join();
+    }
+
+    // 先停止所有的primary线程，再统一delete，防止其他线程窃取时访问已释放的队列
+    target_primary_size_.store(0, std::memory_order_relaxed);
+    int curSize = cur_primary_size_.exchange(0, std::memory_order_acq_rel);
+    for (int i = 0; i < curSize; i++) {
+        status += primary_threads_[i]->destroy();
+    }
+
+    // 主线程停止后，不再有线程轮询，未完成的io直接丢弃
+    status += reactor_.destroy();
+
+    // secondary 线程是智能指针，不需要delete
+    {
+        LOCK_GUARD lk(secondary_mutex_);
+        for (auto &st : secondary_threads_) {
+            status += st->destroy();
+        }
+        for (auto &rt : reserve_threads_) {
+            rt->unpark();
+            status += rt->destroy();
+        }
+    }
+    for (auto &lt : lane_threads_) {
+        status += lt->destroy();
+    }
+    {
+        LOCK_GUARD lk(compensate_mutex_);
+        for (auto &ct : compensate_threads_) {
+            ct->unpark();
+            status += ct->destroy();
+        }
+        compensate_threads_.clear();
+        parked_threads_.clear();
+    }
+
+    // 辅助线程会窃取主线程的任务，需要在其停止后再delete
     for (auto &pt : primary_threads_) {
-        status += pt->destroy();
-        DELETE_PTR(pt)
+        DELETE_PTR(pt)    // primary 线程是普通指针，需要delete
     }
-    FUNCTION_CHECK_STATUS
     primary_threads_.clear();
 
-    // secondary 线程是智能指针，不需要delete
-    for (auto &st : secondary_threads_) {
-        status += st->destroy();
+    /**
+     * 主线程队列中strand的执行任务已被丢弃，strand中未执行的任务一并丢弃（future中返回 broken_promise）
+     * 之后相同key的任务会创建新的strand并重新调度。pool的queue中残留的执行任务，之后执行时strand已为空，不做处理
+     */
+    {
+        LOCK_GUARD lk(strand_mutex_);
+        for (auto& cur : strand_maps_) {
+            cur.second->clear();
+        }
+    }
+
+    // 未执行的任务已被丢弃，仅通道中的任务保留。唤醒 waitIdle() 的等待方
+    CLong lanePending = 0;
+    for (auto& lane : lanes_) {
+        lanePending += (CLong)lane->getStats().pending_num_;
     }
+    quiescence_.reset(lanePending);
+    quiescence_.resume();
     FUNCTION_CHECK_STATUS
-    secondary_threads_.clear();
-    thread_record_map_.clear();
+    {
+        LOCK_GUARD lk(secondary_mutex_);
+        secondary_threads_.clear();
+        reserve_threads_.clear();
+    }
+    lane_threads_.clear();    // 通道保留，未执行的任务在下次init后继续执行
+    {
+        LOCK_GUARD lk(thread_record_mutex_);
+        thread_record_map_.clear();
+    }
     is_init_ = false;
 
     FUNCTION_END
@@ -151,34 +705,222 @@ CIndex UThreadPool::dispatch(CIndex origIndex) {
         return DEFAULT_TASK_STRATEGY;    // 如果开启fair lock，则全部写入 pool的queue中，依次执行
     }
 
-    CIndex realIndex = 0;
-    if (DEFAULT_TASK_STRATEGY == origIndex) {
-        /**
-         * 如果是默认策略信息，在[0, default_thread_size_) 之间的，通过 thread 中queue来调度
-         * 在[default_thread_size_, max_thread_size_) 之间的，通过 pool 中的queue来调度
-         */
-        realIndex = cur_index_++;
-        if (cur_index_ >= config_.max_thread_size_ || cur_index_ < 0) {
-            cur_index_ = 0;
+    if (DEFAULT_TASK_STRATEGY != origIndex) {
+        return origIndex;    // 交到上游去判断，走哪个线程
+    }
+
+    int size = cur_primary_size_.load(std::memory_order_acquire);
+    if (size <= 0) {
+        return DEFAULT_TASK_STRATEGY;
+    }
+
+    /**
+     * 默认策略：随机选取两个主线程，放入队列较短的一个（power of two choices）
+     * 仅比较近似长度（包括收件队列中尚未转入的任务），不加锁。较短的队列也已满时，说明主线程均已饱和，放入pool的queue中
+     */
+    CSize seed = cur_index_.fetch_add(1, std::memory_order_relaxed);
+    CIndex realIndex = (CIndex)(seed % size);
+    if (size > 1) {
+        CSize hash = (CSize)(((unsigned long long)seed * 0x9E3779B97F4A7C15ULL) >> 32);
+        CIndex other = (CIndex)((realIndex + 1 + hash % (size - 1)) % size);
+        if (primary_threads_[other]->getLoad() < primary_threads_[realIndex]->getLoad()) {
+            realIndex = other;
+        }
+    }
+
+    CSize capacity = config_.primary_queue_capacity_;
+    if (capacity > 0 && primary_threads_[realIndex]->work_stealing_queue_.size() >= capacity) {
+        return DEFAULT_TASK_STRATEGY;
+    }
+    return realIndex;
+}
+
+
+CStatus UThreadPool::enqueue(UTask&& task, CIndex index) {
+    FUNCTION_BEGIN
+    growPrimary();
+    beforeEnqueue(task, index);
+    if (DEFAULT_TASK_STRATEGY == index && handoff(task)) {
+        input_task_num_.fetch_add(1, std::memory_order_relaxed);
+        FUNCTION_END
+    }
+
+    CIndex realIndex = dispatch(index);
+    if (realIndex >= 0 && realIndex < cur_primary_size_.load(std::memory_order_acquire)) {
+        // 如果返回的结果，在主线程数量之间，则放到主线程的queue中执行
+        auto primary = primary_threads_[realIndex];
+        if (config_.calcInboxEnable() && primary != UThreadPrimary::current()) {
+            primary->inbox_.push(std::move(task));    // 外部线程写入收件队列，不与主线程竞争锁
+        } else if (!primary->work_stealing_queue_.tryPush(std::move(task))) {
+            status = overflow(std::move(task), realIndex);
         }
+    } else if (LONG_TIME_TASK_STRATEGY == realIndex) {
+        /**
+         * 如果是长时间任务，则交给特定的任务队列，仅由辅助线程处理
+         * 目的是防止有很多长时间任务，将所有运行的线程均阻塞
+         * 长任务程序，默认优先级较低
+         **/
+        priority_task_queue_.push(std::move(task), LONG_TIME_TASK_STRATEGY);
+    } else if (!task_queue_.tryPush(std::move(task))) {
+        // 返回其他结果，放到pool的queue中执行
+        status = overflow(std::move(task), DEFAULT_TASK_STRATEGY);
+    }
+
+    if (status.isOK()) {
+        input_task_num_.fetch_add(1, std::memory_order_relaxed);    // 计数
     } else {
-        realIndex = origIndex;
+        quiescence_.done();    // 被拒绝的任务不会执行
     }
+    FUNCTION_END
+}
 
-    return realIndex;    // 交到上游去判断，走哪个线程
+
+CVoid UThreadPool::beforeEnqueue(UTaskRef task, CIndex index) {
+    UTaskHooks::onEnqueue(task.getHookContext());
+    UTHREADPOOL_TRACE(enqueue, task.getTraceId(), index);
+    quiescence_.add();
 }
 
 
-CStatus UThreadPool::createSecondaryThread(CInt size) {
+CVoid UThreadPool::drainStrand(UStrandMapBasePtr map, const UStrandPtr& strand) {
+    UThreadBasePtr thread = UThreadBase::currentThread();
+    CSize size = strand->drain(config_.strand_batch_size_, [this, thread](UTaskRef task) {
+        runTask(thread, task);
+    });
+    if (map->finish(strand, size) > 0) {
+        scheduleStrand(map, strand);    // 重新排队，让其他任务有机会执行
+    }
+}
+
+
+CVoid UThreadPool::runTask(UThreadBasePtr thread, UTaskRef task) {
+    if (nullptr != thread) {
+        thread->runTask(task);
+        return;
+    }
+
+    // 不在工作线程中时（理论上不会出现），仅执行钩子并计数
+    UTaskHooks::beforeRun(task.getHookContext());
+    task();
+    UTaskHooks::afterRun(task.getHookContext());
+    quiescence_.done();
+}
+
+
+CVoid UThreadPool::scheduleStrand(UStrandMapBasePtr map, const UStrandPtr& strand) {
+    // 执行任务本身也计数，strand中的任务在 enqueueKeyed() 中单独计数
+    quiescence_.add();
+    UTask task([this, map, strand] { drainStrand(map, strand); });
+    UTHREADPOOL_TRACE(enqueue, task.getTraceId(), DEFAULT_TASK_STRATEGY);    // 内部任务，不执行钩子
+    if (handoff(task)) {
+        return;
+    }
+
+    CIndex realIndex = dispatch(DEFAULT_TASK_STRATEGY);
+    if (realIndex >= 0 && realIndex < cur_primary_size_.load(std::memory_order_acquire)) {
+        primary_threads_[realIndex]->work_stealing_queue_.push(std::move(task));
+    } else {
+        task_queue_.push(std::move(task));
+    }
+}
+
+
+CVoid UThreadPool::post(UTask&& task) {
+    auto primary = UThreadPrimary::current();
+    if (nullptr == primary || primary->pool_threads_ != &primary_threads_) {
+        enqueue(std::move(task), DEFAULT_TASK_STRATEGY);
+        return;
+    }
+
+    // 后续任务大概率会使用前序任务的结果，留在本线程中执行对缓存更友好
+    beforeEnqueue(task, DEFAULT_TASK_STRATEGY);
+    primary->work_stealing_queue_.push(std::move(task));
+    input_task_num_.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+CBool UThreadPool::handoff(UTask& task) {
+    if (!config_.mailbox_enable_ || config_.fair_lock_enable_) {
+        return false;
+    }
+
+    int index = idle_bitmap_.claim(cur_primary_size_.load(std::memory_order_acquire));
+    if (index < 0) {
+        return false;
+    }
+
+    auto primary = primary_threads_[index];
+    if (primary->mailbox_.tryPut(task)) {
+        return true;
+    }
+
+    /**
+     * 信箱正在被其他线程取出时写入失败，此时该线程仍处于空闲状态（is_idle_ 为true），
+     * 不会再次标记，需要恢复被认领的标记。即使该线程恰好转为忙碌，多余的标记也只会让之后的任务
+     * 写入其信箱，在当前任务完成后执行或被相邻线程取走，不会丢失
+     * 信箱已关闭表示线程已停止，重新init时会清除空闲状态，不需要恢复
+     */
+    if (primary->mailbox_.isOpen()) {
+        idle_bitmap_.set(index);
+    }
+    return false;
+}
+
+
+CStatus UThreadPool::overflow(UTask&& task, CIndex index) {
     FUNCTION_BEGIN
+    CBool result = false;
+    switch (config_.overflow_policy_) {
+        case OVERFLOW_POLICY_BLOCK:
+            result = (DEFAULT_TASK_STRATEGY == index)
+                     ? task_queue_.waitPush(std::move(task), config_.overflow_block_ttl_)
+                     : primary_threads_[index]->work_stealing_queue_.waitPush(std::move(task), config_.overflow_block_ttl_);
+            break;
+        case OVERFLOW_POLICY_CALLER_RUNS:
+            task();    // 由提交线程直接执行，天然对上游形成反压
+            quiescence_.done();
+            result = true;
+            break;
+        case OVERFLOW_POLICY_SPILL:
+            result = (DEFAULT_TASK_STRATEGY != index) && task_queue_.tryPush(std::move(task));
+            break;
+        default:
+            break;
+    }
+
+    if (!result) {
+        status.setStatus("task queue is full");
+    }
+    FUNCTION_END
+}
+
 
-    int leftSize = (int)(config_.max_thread_size_ - config_.default_thread_size_ - secondary_threads_.size());
+CStatus UThreadPool::createSecondaryThread(CInt size, CBool onlyIfEmpty) {
+    FUNCTION_BEGIN
+    LOCK_GUARD lk(secondary_mutex_);
+    if (onlyIfEmpty && !secondary_threads_.empty()) {
+        FUNCTION_END
+    }
+
+    int leftSize = (int)(config_.max_thread_size_ - cur_primary_size_.load(std::memory_order_acquire) - secondary_threads_.size());
     int realSize = std::min(size, leftSize);    // 使用 realSize 来确保所有的线程数量之和，不会超过设定max值
     for (int i = 0; i < realSize; i++) {
+        if (!reserve_threads_.empty()) {
+            // 复用备用线程，避免重复创建和回收线程
+            reserve_threads_.front()->activate();
+            secondary_threads_.splice(secondary_threads_.end(), reserve_threads_, reserve_threads_.begin());
+            UTHREADPOOL_TRACE(secondary_create, secondary_threads_.size(), true);
+            continue;
+        }
+
         auto ptr = MAKE_UNIQUE_COBJECT(UThreadSecondary)
         ptr->setThreadPoolInfo(&task_queue_, &priority_task_queue_, &config_);
+        ptr->setLaneInfo(&lane_ptrs_, nullptr);
+        ptr->setStealInfo(&primary_threads_, &cur_primary_size_);
+        ptr->setQuiescence(&quiescence_);
         status += ptr->init();
         secondary_threads_.emplace_back(std::move(ptr));
+        UTHREADPOOL_TRACE(secondary_create, secondary_threads_.size(), false);
     }
 
     FUNCTION_END
@@ -186,19 +928,24 @@ CStatus UThreadPool::createSecondaryThread(CInt size) {
 
 
 CVoid UThreadPool::monitor() {
-    while (is_monitor_) {
-        while (is_monitor_ && !is_init_) {
-            // 如果没有init，则一直处于空跑状态
-            SLEEP_SECOND(1)
+    while (true) {
+        {
+            // 通过条件变量等待，析构时可以立即退出
+            UNIQUE_LOCK lk(monitor_mutex_);
+            monitor_cv_.wait_for(lk, std::chrono::seconds(config_.monitor_span_),
+                                 [this] { return !is_monitor_; });
+            if (!is_monitor_) {
+                break;
+            }
         }
 
-        int span = config_.monitor_span_;
-        while (is_monitor_ && is_init_ && span--) {
-            SLEEP_SECOND(1)    // 保证可以快速退出
+        if (!is_init_) {
+            continue;    // 如果没有init，则一直处于空跑状态
         }
 
         // 如果 primary线程都在执行，则表示忙碌
-        bool busy = std::all_of(primary_threads_.begin(), primary_threads_.end(),
+        auto end = primary_threads_.begin() + cur_primary_size_.load(std::memory_order_acquire);
+        bool busy = std::all_of(primary_threads_.begin(), end,
                                 [](UThreadPrimaryPtr ptr) { return nullptr != ptr && ptr->is_running_; });
 
         // 如果忙碌或者priority_task_queue_中有任务，则需要添加 secondary线程
@@ -206,9 +953,29 @@ CVoid UThreadPool::monitor() {
             createSecondaryThread(1);
         }
 
-        // 判断 secondary 线程是否需要退出
+        // 判断 secondary 线程是否需要退出。备用线程未满时挂起，而不是回收
+        LOCK_GUARD lk(secondary_mutex_);
         for (auto iter = secondary_threads_.begin(); iter != secondary_threads_.end(); ) {
-            (*iter)->freeze() ? secondary_threads_.erase(iter++) : iter++;
+            if (!(*iter)->freeze()) {
+                iter++;
+            } else if ((int)reserve_threads_.size() < config_.secondary_reserve_size_) {
+                (*iter)->park();
+                reserve_threads_.splice(reserve_threads_.end(), secondary_threads_, iter++);
+                UTHREADPOOL_TRACE(secondary_park, secondary_threads_.size(), reserve_threads_.size());
+            } else {
+                secondary_threads_.erase(iter++);
+                UTHREADPOOL_TRACE(secondary_release, secondary_threads_.size(), reserve_threads_.size());
+            }
+        }
+
+        // 挂起时间过长的备用线程，需要回收
+        for (auto iter = reserve_threads_.begin(); iter != reserve_threads_.end(); ) {
+            if ((*iter)->isParkExpired(config_.secondary_reserve_ttl_)) {
+                (*iter)->unpark();
+                reserve_threads_.erase(iter++);
+            } else {
+                iter++;
+            }
         }
     }
 }
\ No newline at end of file
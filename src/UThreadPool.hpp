@@ -8,11 +8,14 @@
 #include <vector>
 #include <list>
 #include <map>
+#include <unordered_map>
+#include <typeindex>
 #include <future>
 #include <thread>
 #include <algorithm>
 #include <memory>
 #include <functional>
+#include <condition_variable>
 
 #include "./Queue/UQueueInclude.hpp"
 #include "./ThreadPoolinc.hpp"
@@ -20,10 +23,81 @@
 #include "./Thread/UThreadInclude.hpp"
 #include "./Task/UTaskGroup.hpp"
 #include "./Task/UTask.hpp"
+#include "./Task/UFutureTask.hpp"
+#include "./Task/UFuture.hpp"
+#include "./Task/UCancellationToken.hpp"
+#include "./Task/UStrand.hpp"
+#include "./Timer/UTimerWheel.hpp"
+#include "./Lane/ULane.hpp"
+#include "./Reactor/UReactor.hpp"
 #include "./CFuncType.hpp"
 
 class UThreadPool {
 public:
+    /**
+     * 阻塞区域。任务在执行阻塞操作（io、等待锁等）之前创建，离开作用域时结束
+     * 在主线程中创建时，立即由补偿线程接管该主线程的队列，保证有效并发数不变
+     * 在非主线程中创建，或者嵌套创建时，不做任何处理
+     */
+    class BlockingScope {
+    public:
+        explicit BlockingScope(UThreadPool* pool);
+        ~BlockingScope();
+
+        NO_ALLOWED_COPY(BlockingScope)
+
+    private:
+        UThreadPool* pool_ = nullptr;
+        UThreadPrimaryPtr primary_ = nullptr;                    // 被阻塞的主线程
+        UThreadSecondaryPtr compensate_ = nullptr;               // 接管队列的补偿线程
+    };
+
+    /**
+     * 分治任务的作用域。spawn() 的子任务直接放入当前主线程的队列，不创建future
+     * sync() 时优先执行本线程队列中的子任务；子任务被其他线程窃取时，继续窃取任务执行，
+     * 直到所有子任务完成。在非主线程中使用时，子任务正常提交，sync() 让出cpu等待
+     * 线程池暂停时，sync() 不再获取任务，阻塞到恢复为止
+     */
+    class TaskScope {
+    public:
+        explicit TaskScope(UThreadPool* pool);
+        ~TaskScope();
+
+        /**
+         * 创建子任务
+         * @tparam FunctionType
+         * @param func
+         */
+        template<typename FunctionType>
+        CVoid spawn(const FunctionType& func);
+
+        /**
+         * 等待所有子任务完成。子任务抛出异常时，重新抛出第一个异常
+         */
+        CVoid sync();
+
+        NO_ALLOWED_COPY(TaskScope)
+
+    private:
+        /**
+         * 执行任务，直到所有子任务完成
+         */
+        CVoid wait();
+
+        /**
+         * 记录子任务的异常，仅保留第一个
+         * @param ptr
+         */
+        CVoid setException(std::exception_ptr ptr);
+
+    private:
+        UThreadPool* pool_ = nullptr;
+        UThreadPrimaryPtr primary_ = nullptr;                    // 当前主线程，非本线程池的主线程时为空
+        std::atomic<CSize> pending_ { 0 };                       // 尚未完成的子任务个数
+        std::atomic<CBool> has_exception_ { false };             // 是否已记录异常
+        std::exception_ptr exception_ = nullptr;                 // 第一个子任务异常
+    };
+
     /**
      * 通过默认设置参数，来创建线程池
      * @param autoInit 是否自动开启线程池功能
@@ -63,6 +137,61 @@ public:
                 CIndex index = DEFAULT_TASK_STRATEGY)
     -> std::future<typename std::result_of<FunctionType()>::type>;
 
+    /**
+     * 尝试提交任务信息。队列已满且处理策略为拒绝（或阻塞超时）时，返回异常状态
+     * @tparam FunctionType
+     * @param func
+     * @param result 提交成功时，写入任务对应的future
+     * @param index
+     * @return
+     */
+    template<typename FunctionType>
+    CStatus tryCommit(const FunctionType& func,
+                      std::future<typename std::result_of<FunctionType()>::type>& result,
+                      CIndex index = DEFAULT_TASK_STRATEGY);
+
+    /**
+     * 提交可取消的任务信息
+     * 出队时若token已被取消，则不执行func，future中返回 CException("task is cancelled")
+     * @tparam FunctionType
+     * @param func
+     * @param token
+     * @param index
+     * @return
+     */
+    template<typename FunctionType>
+    auto commit(const FunctionType& func,
+                const UCancellationToken& token,
+                CIndex index = DEFAULT_TASK_STRATEGY)
+    -> std::future<typename std::result_of<FunctionType()>::type>;
+
+    /**
+     * 按key串行提交任务。相同key的任务按照提交顺序逐个执行，不同key之间可以并行
+     * @tparam KeyType 需要支持 std::hash
+     * @tparam FunctionType
+     * @param key
+     * @param func
+     * @return
+     * @notice 每个key使用独立的strand，仅在有未执行的任务时存在。不同key之间互不影响
+     *         keyed任务中不要阻塞等待相同key的任务，被等待的任务排在当前任务之后，永远不会执行
+     */
+    template<typename KeyType, typename FunctionType>
+    auto commitKeyed(const KeyType& key,
+                     const FunctionType& func)
+    -> std::future<typename std::result_of<FunctionType()>::type>;
+
+    /**
+     * 向通道中提交任务
+     * @tparam FunctionType
+     * @param lane 通过 createLane() 获取
+     * @param func
+     * @return
+     */
+    template<typename FunctionType>
+    auto commit(ULanePtr lane,
+                const FunctionType& func)
+    -> std::future<typename std::result_of<FunctionType()>::type>;
+
     /**
      * 根据优先级，执行任务
      * @tparam FunctionType
@@ -76,6 +205,36 @@ public:
                             int priority)
     -> std::future<typename std::result_of<FunctionType()>::type>;
 
+    /**
+     * 提交任务信息，返回可以注册后续任务的 UFuture
+     * @tparam FunctionType
+     * @param func
+     * @param index
+     * @return 任务被拒绝时，future中返回 broken_promise
+     */
+    template<typename FunctionType>
+    auto commitAsync(const FunctionType& func,
+                     CIndex index = DEFAULT_TASK_STRATEGY)
+    -> UFuture<typename std::result_of<FunctionType()>::type>;
+
+    /**
+     * 所有future就绪后，返回的future就绪。通过原子计数实现，不占用任何线程
+     * @tparam T
+     * @param futures 被移入结果中，可以从结果中逐个获取
+     * @return
+     */
+    template<typename T>
+    UFuture<std::vector<UFuture<T>>> whenAll(std::vector<UFuture<T>>&& futures);
+
+    /**
+     * 任意一个future就绪后，返回的future就绪
+     * @tparam T
+     * @param futures 被移入结果中，可以从结果中逐个获取
+     * @return 传入为空时，future中返回 broken_promise
+     */
+    template<typename T>
+    UFuture<UWhenAnyResult<T>> whenAny(std::vector<UFuture<T>>&& futures);
+
     /**
      * 执行任务组信息
      * 取taskGroup内部ttl和入参ttl的最小值，为计算ttl标准
@@ -97,6 +256,105 @@ public:
                    CMSec ttl = MAX_BLOCK_TTL,
                    CALLBACK_CONST_FUNCTION_REF onFinished = nullptr);
 
+    /**
+     * 异步执行任务组，不阻塞当前线程
+     * 所有任务完成后，或者超过ttl时，在对应的线程中执行 on_finished_，且仅执行一次
+     * @param taskGroup
+     * @param ttl
+     * @return 提交状态，执行结果通过 on_finished_ 获取
+     */
+    CStatus submitAsync(const UTaskGroup& taskGroup,
+                        CMSec ttl = MAX_BLOCK_TTL);
+
+    /**
+     * 延时执行任务
+     * @param func
+     * @param delay 延时时间，单位为ms
+     * @return 定时任务id，失败返回0
+     */
+    UTimerId commitAfter(DEFAULT_CONST_FUNCTION_REF func,
+                         CMSec delay);
+
+    /**
+     * 周期执行任务，首次执行在 interval 之后
+     * @param func
+     * @param interval 周期时间，单位为ms
+     * @return 定时任务id，失败返回0
+     */
+    UTimerId commitEvery(DEFAULT_CONST_FUNCTION_REF func,
+                         CMSec interval);
+
+    /**
+     * 取消定时任务
+     * @param id
+     * @return 是否取消成功
+     * @notice 已经投递到队列中的任务，不会被取消
+     */
+    CBool cancelTimer(UTimerId id);
+
+    /**
+     * 创建任务通道，需要在init()函数调用前完成
+     * 通道之间的任务相互隔离。空闲线程按照权重轮询各个通道，专属线程优先处理本通道的任务
+     * @param name
+     * @param weight 权重，即每轮最多连续获取的任务个数
+     * @param reservedSize 专属线程个数，不受 max_thread_size_ 限制
+     * @return 通道句柄，在线程池析构前有效。创建失败返回nullptr
+     */
+    ULanePtr createLane(const std::string& name,
+                        CUint weight = 1,
+                        int reservedSize = 0);
+
+    /**
+     * 等待所有已提交的任务执行完成，包括任务执行过程中新提交的任务
+     * 基于全局的任务计数，等待方挂起，计数减为0时被唤醒，不会轮询
+     * @param ttl 最大等待时间，单位为ms
+     * @return 超时返回异常状态
+     * @notice 暂停期间，队列中的任务不会执行，等待会超时；尚未到期的定时任务不计入
+     */
+    CStatus waitIdle(CMSec ttl = MAX_BLOCK_TTL);
+
+    /**
+     * 暂停获取任务。正在执行的任务不受影响，新任务可以继续提交
+     * 工作线程在获取下一个任务前挂起，不会销毁
+     */
+    CVoid pause();
+
+    /**
+     * 恢复获取任务
+     */
+    CVoid resume();
+
+    /**
+     * 协作式让出点，供长任务在执行过程中周期性调用
+     * 当前主线程的队列中有等待的任务时，在当前栈上执行其中一个；嵌套超过 MAX_YIELD_POINT_DEPTH 层时，
+     * 不再执行，而是将本地队列中的任务转入pool的队列，由其他线程执行
+     * 非本线程池的主线程中调用，处于 BlockingScope 中，或者线程池暂停时，不做任何处理
+     * @return 是否执行或转出了等待的任务
+     * @notice 调用时不要持有锁，被执行的任务可能需要同一把锁
+     */
+    CBool yieldPoint();
+
+    /**
+     * 在线调整主线程个数，无需destroy后重新init
+     * 扩容时启动新线程；缩容时回收末尾的线程，并将其队列中的任务分给剩余线程
+     * @param size 范围为 [1, max(max_thread_size_, default_thread_size_)]
+     * @return
+     */
+    CStatus resizePrimary(int size);
+
+    /**
+     * 获取当前生效的主线程个数
+     * @return
+     */
+    int getPrimarySize() const;
+
+    /**
+     * 获取io反应器，用于注册fd、异步读写和定时任务。回调作为任务在主线程中执行
+     * @return 未开启 reactor_enable_ 或未初始化时，返回nullptr
+     * @notice 反应器仅由空闲的主线程轮询，所有主线程繁忙时，事件会延迟处理
+     */
+    UReactorPtr getReactor();
+
     /**
      * 获取根据线程id信息，获取线程num信息
      * @param tid
@@ -117,15 +375,139 @@ protected:
      * 根据传入的策略信息，确定最终执行方式
      * @param origIndex
      * @return
+     * @notice 保留为虚函数，作为自定义调度策略的扩展点。需要编译期确定调度方式时，使用 UBasicThreadPool
      */
     virtual CIndex dispatch(CIndex origIndex);
 
     /**
-     * 生成辅助线程。内部确保辅助线程数量不超过设定参数
+     * 根据调度结果，将任务放入对应的队列中
+     * @param task
+     * @param index
+     * @return 队列已满并被拒绝时，返回异常状态
+     */
+    CStatus enqueue(UTask&& task, CIndex index);
+
+    /**
+     * 任务写入任意队列之前调用，所有提交路径共用：执行钩子、触发 enqueue 探针并计数
+     * 先计数再写入，保证任务执行完成前计数不会减为0
+     * @param task
+     * @param index 提交时指定的线程，未指定时为 DEFAULT_TASK_STRATEGY
+     * @return
+     */
+    CVoid beforeEnqueue(UTaskRef task, CIndex index);
+
+    /**
+     * 有空闲的主线程时，将任务直接写入其信箱
+     * @param task 仅在投递成功时被移走
+     * @return 是否投递成功
+     */
+    CBool handoff(UTask& task);
+
+    /**
+     * 调度后续任务。在主线程中调用时，直接放入本线程的队列，其他情况按默认策略写入
+     * @param task
+     * @return
+     */
+    CVoid post(UTask&& task);
+
+    /**
+     * 队列已满时，根据 overflow_policy_ 处理任务
+     * @param task
+     * @param index 写入失败的队列，DEFAULT_TASK_STRATEGY 表示pool的queue
+     * @return
+     */
+    CStatus overflow(UTask&& task, CIndex index);
+
+    /**
+     * 接收时间轮中到期的任务，写入主线程的队列。设置了容量时逐个写入，已满时根据 overflow_policy_ 处理
+     * @param tasks
+     * @return
+     */
+    CVoid deliverTimerTasks(UTaskArrRef tasks);
+
+    /**
+     * 获取key类型对应的strand容器，不存在时创建。容器与线程池生命周期一致
+     * @tparam KeyType
+     * @return
+     */
+    template<typename KeyType>
+    UStrandMap<KeyType>* getStrandMap();
+
+    /**
+     * 将任务写入key对应的strand中，strand由空变为非空时，将其调度到线程池中
+     * @tparam KeyType
+     * @param key
+     * @param task
+     * @return
+     */
+    template<typename KeyType>
+    CStatus enqueueKeyed(const KeyType& key, UTask&& task);
+
+    /**
+     * 执行strand中的任务，仍有剩余时重新调度
+     * @param map strand所在的容器
+     * @param strand
+     * @return
+     */
+    CVoid drainStrand(UStrandMapBasePtr map, const UStrandPtr& strand);
+
+    /**
+     * 在指定的工作线程中执行任务，与队列中取出的任务经过相同的流程（钩子、探针、标签统计、计数）
+     * @param thread 当前工作线程，为空时仅执行钩子并计数
+     * @param task
+     */
+    CVoid runTask(UThreadBasePtr thread, UTaskRef task);
+
+    /**
+     * 将strand的执行任务放入队列中，不受容量限制，确保strand不会丢失调度
+     * @param map strand所在的容器
+     * @param strand
+     * @return
+     */
+    CVoid scheduleStrand(UStrandMapBasePtr map, const UStrandPtr& strand);
+
+    /**
+     * 生成辅助线程。优先激活备用线程，不足时再创建。内部确保辅助线程数量不超过设定参数
      * @param size
+     * @param onlyIfEmpty 为true时，仅在没有辅助线程时生成
      * @return
      */
-    CStatus createSecondaryThread(CInt size);
+    CStatus createSecondaryThread(CInt size, CBool onlyIfEmpty = false);
+
+    /**
+     * 获取一个补偿线程，并接管主线程的队列。没有挂起的补偿线程时新建，超过上限时返回nullptr
+     * @param primary
+     * @return
+     */
+    UThreadSecondaryPtr acquireCompensate(UThreadPrimaryPtr primary);
+
+    /**
+     * 归还补偿线程，使其挂起以便复用
+     * @param thread
+     * @return
+     */
+    CVoid releaseCompensate(UThreadSecondaryPtr thread);
+
+    /**
+     * 延迟启动模式下，主线程未达到目标个数且均在忙碌时，启动一个新的主线程
+     * 未达到条件或者正在调整主线程个数时，直接返回，不会阻塞提交方
+     * @return
+     */
+    CVoid growPrimary();
+
+    /**
+     * 启动对应槽位的主线程，并记录线程id信息
+     * @param index
+     * @return
+     */
+    CStatus startPrimary(int index);
+
+    /**
+     * 停止对应槽位的主线程，等待正在执行的任务完成。队列中的任务保留
+     * @param index
+     * @return
+     */
+    CStatus stopPrimary(int index);
 
     /**
      * 监控线程执行函数，主要是判断是否需要增加线程，或销毁线程
@@ -135,21 +517,45 @@ protected:
 
     NO_ALLOWED_COPY(UThreadPool)
 
+    template<typename T> friend class UFuture;
+
 private:
     CBool is_init_ { false };                                                       // 是否初始化
     CBool is_monitor_ { true };                                                     // 是否需要监控
-    CInt cur_index_ = 0;                                                            // 记录放入的线程数
-    CULong input_task_num_ = 0;                                                     // 放入的任务的个数
+    std::atomic<CSize> cur_index_ { 0 };                                            // 选择主线程的随机种子，多个提交方并发递增
+    std::atomic<CULong> input_task_num_ { 0 };                                      // 放入的任务的个数，仅用于统计
+    UQuiescence quiescence_;                                                        // 记录未完成的任务个数，以及暂停状态
     UAtomicQueue<UTask> task_queue_;                                                // 用于存放普通任务
     UAtomicPriorityQueue<UTask> priority_task_queue_;                               // 运行时间较长的任务队列，仅在辅助线程中执行
-    std::vector<UThreadPrimaryPtr> primary_threads_;                                // 记录所有的主线程
+    std::vector<UThreadPrimaryPtr> primary_threads_;                                // 记录所有的主线程槽位，init之后个数不再变化
+    std::atomic<int> cur_primary_size_ { 0 };                                       // 当前生效的主线程个数，即 primary_threads_ 中的前n个
+    std::atomic<int> target_primary_size_ { 0 };                                    // 目标主线程个数，延迟启动时逐步达到
+    UIdleBitmap idle_bitmap_;                                                       // 空闲主线程的标记，用于直接投递
+    std::mutex resize_mutex_;                                                       // 保证同一时刻只有一个resize操作
     std::list<std::unique_ptr<UThreadSecondary>> secondary_threads_;                // 用于记录所有的辅助线程
+    std::list<std::unique_ptr<UThreadSecondary>> reserve_threads_;                  // 挂起的备用辅助线程，创建辅助线程时优先复用
+    std::mutex secondary_mutex_;                                                    // 保护 secondary_threads_ 和 reserve_threads_，监控线程和提交线程都会修改
     UThreadPoolConfig config_;                                                      // 线程池设置值
-    std::thread monitor_thread_;                                                    // 监控线程
+    std::thread monitor_thread_;                                                    // 监控线程，开启监控时在第一次init时启动
+    std::mutex monitor_mutex_;                                                      // 配合 monitor_cv_ 使用
+    std::condition_variable monitor_cv_;                                            // 监控线程的等待，析构时直接唤醒
+    UTimerWheel timer_wheel_;                                                       // 时间轮，用于延时和周期任务
+    std::thread timer_thread_;                                                      // 定时线程，推进时间轮
+    UReactor reactor_;                                                              // io反应器，由空闲的主线程轮询
+    std::vector<std::unique_ptr<ULane>> lanes_;                                     // 所有的任务通道，与线程池生命周期一致
+    std::vector<ULanePtr> lane_ptrs_;                                               // 通道指针，供线程轮询使用
+    std::mutex compensate_mutex_;                                                   // 保护补偿线程信息
+    std::list<std::unique_ptr<UThreadSecondary>> compensate_threads_;               // 所有的补偿线程
+    std::vector<UThreadSecondaryPtr> parked_threads_;                               // 挂起中，可以复用的补偿线程
+    std::list<std::unique_ptr<UThreadSecondary>> lane_threads_;                     // 通道的专属线程
+    std::mutex strand_mutex_;                                                       // 保护 strand_maps_
+    std::unordered_map<std::type_index, std::unique_ptr<UStrandMapBase>> strand_maps_;    // 按key类型区分的strand容器
+    std::mutex thread_record_mutex_;                                                // 保护 thread_record_map_
     std::map<CSize, int> thread_record_map_;                                        // 线程记录的信息，key是线程id，value是线程的index-用于任务窃取等
 };
 
 using UThreadPoolPtr = UThreadPool *;
+using UTaskScope = UThreadPool::TaskScope;
 
 #include "./UThreadPool.inl"
 
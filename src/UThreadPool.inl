@@ -12,44 +12,249 @@ auto UThreadPool::commit(const FunctionType& func, CIndex index)
 -> std::future<typename std::result_of<FunctionType()>::type> {
     using ResultType = typename std::result_of<FunctionType()>::type;
 
-    std::packaged_task<ResultType()> task(func);
-    std::future<ResultType> result(task.get_future());
+    UFutureTask<FunctionType, ResultType> task(func);
+    std::future<ResultType> result(task.getFuture());
 
-    CIndex realIndex = dispatch(index);
-    if (realIndex >= 0 && realIndex < config_.default_thread_size_) {
-        // 如果返回的结果，在主线程数量之间，则放到主线程的queue中执行
-        primary_threads_[realIndex]->work_stealing_queue_.push(std::move(task));
-    } else if (LONG_TIME_TASK_STRATEGY == realIndex) {
-        /**
-         * 如果是长时间任务，则交给特定的任务队列，仅由辅助线程处理
-         * 目的是防止有很多长时间任务，将所有运行的线程均阻塞
-         * 长任务程序，默认优先级较低
-         **/
-        priority_task_queue_.push(std::move(task), LONG_TIME_TASK_STRATEGY);
-    } else {
-        // 返回其他结果，放到pool的queue中执行
-        task_queue_.push(std::move(task));
+    enqueue(std::move(task), index);    // 被拒绝的任务，future中返回 broken_promise
+    return result;
+}
+
+
+template<typename FunctionType>
+CStatus UThreadPool::tryCommit(const FunctionType& func,
+                               std::future<typename std::result_of<FunctionType()>::type>& result,
+                               CIndex index) {
+    using ResultType = typename std::result_of<FunctionType()>::type;
+
+    UFutureTask<FunctionType, ResultType> task(func);
+    std::future<ResultType> future(task.getFuture());
+
+    CStatus status = enqueue(std::move(task), index);
+    if (status.isOK()) {
+        result = std::move(future);
     }
-    input_task_num_++;    // 计数
+    return status;
+}
+
+
+template<typename FunctionType>
+auto UThreadPool::commit(const FunctionType& func,
+                         const UCancellationToken& token,
+                         CIndex index)
+-> std::future<typename std::result_of<FunctionType()>::type> {
+    using ResultType = typename std::result_of<FunctionType()>::type;
+
+    UCancellableTask<FunctionType, ResultType> task(func, token);
+    std::future<ResultType> result(task.getFuture());
+
+    enqueue(std::move(task), index);
     return result;
 }
 
 
+template<typename FunctionType>
+auto UThreadPool::commit(ULanePtr lane, const FunctionType& func)
+-> std::future<typename std::result_of<FunctionType()>::type> {
+    using ResultType = typename std::result_of<FunctionType()>::type;
+
+    UFutureTask<FunctionType, ResultType> task(func);
+    std::future<ResultType> result(task.getFuture());
+
+    if (nullptr != lane) {
+        UTask laneTask(std::move(task));
+        beforeEnqueue(laneTask, DEFAULT_TASK_STRATEGY);
+        lane->push(std::move(laneTask));
+        input_task_num_.fetch_add(1, std::memory_order_relaxed);
+    }    // 通道为空时，任务被丢弃，future中返回 broken_promise
+    return result;
+}
+
+
+template<typename KeyType, typename FunctionType>
+auto UThreadPool::commitKeyed(const KeyType& key, const FunctionType& func)
+-> std::future<typename std::result_of<FunctionType()>::type> {
+    using ResultType = typename std::result_of<FunctionType()>::type;
+
+    UFutureTask<FunctionType, ResultType> task(func);
+    std::future<ResultType> result(task.getFuture());
+
+    enqueueKeyed(key, std::move(task));
+    return result;
+}
+
+
+template<typename KeyType>
+UStrandMap<KeyType>* UThreadPool::getStrandMap() {
+    LOCK_GUARD lk(strand_mutex_);
+    auto& map = strand_maps_[std::type_index(typeid(KeyType))];
+    if (nullptr == map) {
+        map.reset(new UStrandMap<KeyType>(config_.strand_shard_size_));
+    }
+    return static_cast<UStrandMap<KeyType> *>(map.get());
+}
+
+
+template<typename KeyType>
+CStatus UThreadPool::enqueueKeyed(const KeyType& key, UTask&& task) {
+    FUNCTION_BEGIN
+    ASSERT_INIT(true)
+
+    growPrimary();
+    auto map = getStrandMap<KeyType>();
+    beforeEnqueue(task, DEFAULT_TASK_STRATEGY);
+    auto strand = map->push(key, std::move(task));
+    if (nullptr != strand) {
+        scheduleStrand(map, strand);
+    }
+    input_task_num_.fetch_add(1, std::memory_order_relaxed);
+    FUNCTION_END
+}
+
+
 template<typename FunctionType>
 auto UThreadPool::commitWithPriority(const FunctionType& func, int priority)
 -> std::future<typename std::result_of<FunctionType()>::type> {
     using ResultType = typename std::result_of<FunctionType()>::type;
 
-    std::packaged_task<ResultType()> task(func);
-    std::future<ResultType> result(task.get_future());
+    UFutureTask<FunctionType, ResultType> task(func);
+    std::future<ResultType> result(task.getFuture());
+
+    createSecondaryThread(1, true);    // 如果没有开启辅助线程，则直接开启一个
+
+    UTask priorityTask(std::move(task));
+    beforeEnqueue(priorityTask, DEFAULT_TASK_STRATEGY);
+    priority_task_queue_.push(std::move(priorityTask), priority);
+    input_task_num_.fetch_add(1, std::memory_order_relaxed);
+    return result;
+}
+
 
-    if (secondary_threads_.empty()) {
-        createSecondaryThread(1);    // 如果没有开启辅助线程，则直接开启一个
+template<typename FunctionType>
+auto UThreadPool::commitAsync(const FunctionType& func, CIndex index)
+-> UFuture<typename std::result_of<FunctionType()>::type> {
+    using ResultType = typename std::result_of<FunctionType()>::type;
+
+    UPromiseTask<FunctionType, ResultType> task(func);
+    UFuture<ResultType> result(task.getFuture(this));
+
+    enqueue(std::move(task), index);    // 被拒绝的任务，future中返回 broken_promise
+    return result;
+}
+
+
+template<typename T>
+UFuture<std::vector<UFuture<T>>> UThreadPool::whenAll(std::vector<UFuture<T>>&& futures) {
+    using ResultType = std::vector<UFuture<T>>;
+    struct UWhenAllContext {
+        std::atomic<CSize> left_ { 0 };                          // 尚未就绪的个数
+        ResultType futures_;
+        UPromise<ResultType> promise_;
+    };
+
+    auto context = std::make_shared<UWhenAllContext>();
+    UFuture<ResultType> result(context->promise_.getFuture(this));
+    if (futures.empty()) {
+        context->promise_.setValue(ResultType());
+        return result;
+    }
+
+    // 最后一个回调会移走 futures_，所以先记录所有的共享状态，再逐个注册
+    std::vector<std::shared_ptr<UFutureState<T>>> states;
+    states.reserve(futures.size());
+    for (auto& future : futures) {
+        states.emplace_back(future.state_);
     }
+    context->left_.store(futures.size(), std::memory_order_relaxed);
+    context->futures_ = std::move(futures);
 
-    priority_task_queue_.push(std::move(task), priority);
-    input_task_num_++;
+    for (auto& state : states) {
+        state->onReady([context] {
+            if (1 == context->left_.fetch_sub(1, std::memory_order_acq_rel)) {
+                context->promise_.setValue(std::move(context->futures_));
+            }
+        });
+    }
     return result;
 }
 
+
+template<typename T>
+UFuture<UWhenAnyResult<T>> UThreadPool::whenAny(std::vector<UFuture<T>>&& futures) {
+    struct UWhenAnyContext {
+        std::atomic<CBool> done_ { false };                      // 是否已有future就绪
+        std::vector<UFuture<T>> futures_;
+        UPromise<UWhenAnyResult<T>> promise_;
+    };
+
+    auto context = std::make_shared<UWhenAnyContext>();
+    UFuture<UWhenAnyResult<T>> result(context->promise_.getFuture(this));
+    if (futures.empty()) {
+        return result;
+    }
+
+    std::vector<std::shared_ptr<UFutureState<T>>> states;
+    states.reserve(futures.size());
+    for (auto& future : futures) {
+        states.emplace_back(future.state_);
+    }
+    context->futures_ = std::move(futures);
+
+    for (CSize i = 0; i < states.size(); i++) {
+        states[i]->onReady([context, i] {
+            if (!context->done_.exchange(true, std::memory_order_acq_rel)) {
+                UWhenAnyResult<T> any;
+                any.index_ = i;
+                any.futures_ = std::move(context->futures_);
+                context->promise_.setValue(std::move(any));
+            }
+        });
+    }
+    return result;
+}
+
+
+template<typename T>
+template<typename FunctionType>
+auto UFuture<T>::then(const FunctionType& func, CBool inlineRun)
+-> UFuture<typename UThenResult<FunctionType, T>::type> {
+    using ResultType = typename UThenResult<FunctionType, T>::type;
+
+    auto promise = std::make_shared<UPromise<ResultType>>();
+    UFuture<ResultType> result(promise->getFuture(pool_));
+    auto state = std::move(state_);
+    UThreadPool* pool = pool_;
+
+    UContinuationTask<FunctionType, T, ResultType> task(state, std::move(promise), func);
+    state->onReady([task, pool, inlineRun]() mutable {
+        if (inlineRun || nullptr == pool) {
+            task();
+        } else {
+            pool->post(UTask(std::move(task)));
+        }
+    });
+    return result;
+}
+
+
+template<typename FunctionType>
+CVoid UThreadPool::TaskScope::spawn(const FunctionType& func) {
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    UTask task([this, func] {
+        try {
+            func();
+        } catch (...) {
+            setException(std::current_exception());
+        }
+        pending_.fetch_sub(1, std::memory_order_release);    // 之后不能再访问this
+    });
+
+    if (nullptr != primary_) {
+        pool_->post(std::move(task));
+    } else if (!pool_->enqueue(std::move(task), DEFAULT_TASK_STRATEGY).isOK()) {
+        // 被拒绝的任务未执行，直接结束，避免sync()一直等待
+        setException(std::make_exception_ptr(CException("task is rejected")));
+        pending_.fetch_sub(1, std::memory_order_release);
+    }
+}
+
 #endif    // UTHREADPOOL_INL
\ No newline at end of file
@@ -6,6 +6,8 @@
 #ifndef UTHREADPOOLCONFIG_H
 #define UTHREADPOOLCONFIG_H
 
+#include <algorithm>
+
 #include "./Queue/UQueueInclude.hpp"
 
 struct UThreadPoolConfig {
@@ -17,7 +19,12 @@ struct UThreadPoolConfig {
     int max_local_batch_size_ = MAX_LOCAL_BATCH_SIZE;
     int max_pool_batch_size_ = MAX_POOL_BATCH_SIZE;
     int max_steal_batch_size_ = MAX_STEAL_BATCH_SIZE;
+    bool adaptive_batch_enable_ = ADAPTIVE_BATCH_ENABLE;
+    int max_adaptive_batch_size_ = MAX_ADAPTIVE_BATCH_SIZE;
+    int batch_time_budget_ = BATCH_TIME_BUDGET;
     int secondary_thread_ttl_ = SECONDARY_THREAD_TTL;
+    int secondary_reserve_size_ = SECONDARY_RESERVE_SIZE;
+    int secondary_reserve_ttl_ = SECONDARY_RESERVE_TTL;
     int monitor_span_ = MONITOR_SPAN;
     int primary_thread_policy_ = PRIMARY_THREAD_POLICY;
     int secondary_thread_policy_ = SECONDARY_THREAD_POLICY;
@@ -27,19 +34,48 @@ struct UThreadPoolConfig {
     bool batch_task_enable_ = BATCH_TASK_ENABLE;
     bool fair_lock_enable_ = FAIR_LOCK_ENABLE;
     bool monitor_enable_ = MONITOR_ENABLE;
+    bool lazy_primary_enable_ = LAZY_PRIMARY_ENABLE;
+    size_t pool_queue_capacity_ = POOL_QUEUE_CAPACITY;
+    size_t primary_queue_capacity_ = PRIMARY_QUEUE_CAPACITY;
+    int overflow_policy_ = OVERFLOW_POLICY;
+    int overflow_block_ttl_ = OVERFLOW_BLOCK_TTL;
+    float queue_high_watermark_ = QUEUE_HIGH_WATERMARK;
+    float queue_low_watermark_ = QUEUE_LOW_WATERMARK;
+    UWatermarkCallback on_high_watermark_ = nullptr;                // 队列超过高水位时的回调，仅在设置容量时生效
+    UWatermarkCallback on_low_watermark_ = nullptr;                 // 队列回落到低水位时的回调
+    int timer_tick_ = DEFAULT_TIMER_TICK;
+    unsigned int timer_capacity_ = DEFAULT_TIMER_CAPACITY;
+    bool timer_by_idle_worker_ = TIMER_BY_IDLE_WORKER;
+    int max_compensate_thread_size_ = MAX_COMPENSATE_THREAD_SIZE;
+    size_t strand_shard_size_ = DEFAULT_STRAND_SHARD_SIZE;           // 仅在第一次提交该类型的key时生效
+    size_t strand_batch_size_ = STRAND_BATCH_SIZE;
+    bool reactor_enable_ = REACTOR_ENABLE;
+    bool mailbox_enable_ = MAILBOX_ENABLE;
+    bool inbox_enable_ = INBOX_ENABLE;                              // 仅在 primary_queue_capacity_ 为0时生效
+    size_t label_sample_period_ = LABEL_SAMPLE_PERIOD;              // 为1时统计每个任务，间隔越大开销越低
 
 
 protected:
     /**
-     * 计算可盗取的范围，盗取范围不能超过默认线程数-1
+     * 计算可盗取的范围，盗取范围不能超过当前主线程数-1
+     * @param threadSize 当前生效的主线程数
      * @return
      */
-    [[nodiscard]] int calcStealRange() const {
-        int range = std::min(this->max_task_steal_range_, this->default_thread_size_ - 1);
+    [[nodiscard]] int calcStealRange(int threadSize) const {
+        int range = std::min(this->max_task_steal_range_, threadSize - 1);
         return range;
     }
 
 
+    /**
+     * 计算主线程的槽位个数，即 resizePrimary() 可以设置的上限
+     * @return
+     */
+    [[nodiscard]] int calcPrimarySlotSize() const {
+        return std::max(this->max_thread_size_, this->default_thread_size_);
+    }
+
+
     /**
      * 计算是否开启批量任务
      * 开启条件：开关批量开启，并且 未开启非公平锁
@@ -50,6 +86,31 @@ protected:
         return ratio;
     }
 
+
+    /**
+     * 计算是否开启收件队列。收件队列不受容量限制，所以主线程queue设置容量时不开启
+     * @return
+     */
+    [[nodiscard]] bool calcInboxEnable() const {
+        return this->inbox_enable_ && 0 == this->primary_queue_capacity_;
+    }
+
+
+    /**
+     * 根据容量和比例，计算水位值。容量为0时不开启水位检测
+     * @param capacity
+     * @param ratio
+     * @return
+     */
+    [[nodiscard]] static size_t calcWatermark(size_t capacity, float ratio) {
+        if (0 == capacity) {
+            return 0;
+        }
+        auto watermark = (size_t)((float)capacity * std::min(std::max(ratio, 0.0f), 1.0f));
+        return std::max<size_t>(watermark, 1);
+    }
+
+    friend class UThreadPool;
     friend class UThreadPrimary;
     friend class UThreadSecondary;
 };
@@ -0,0 +1,50 @@
+/***************************
+@File: UTrace.h
+@Desc: 静态探针(USDT)。linux下存在 sys/sdt.h 时，在二进制中埋入 uthreadpool 探针，
+       未挂载bpftrace/perf时仅为一条nop指令；挂载后可以在不重新编译的情况下观察任务的排队和执行
+       其他平台，或者定义了 _UTHREADPOOL_TRACE_DISABLE_ 时，探针为空，参数不会被求值
+       时间戳和线程id由追踪工具在探针触发时记录，探针本身不读取时钟
+***************************/
+
+#ifndef UTRACE_H
+#define UTRACE_H
+
+#if defined(__linux__) && defined(__has_include) && !defined(_UTHREADPOOL_TRACE_DISABLE_)
+    #if __has_include(<sys/sdt.h>)
+        #include <sys/sdt.h>
+        #define _UTHREADPOOL_TRACE_ENABLE_
+    #endif
+#endif
+
+/**
+ * 探针为空时使用，仅用于引用参数，避免 unused 告警。位于 if (false) 分支中，参数不会被求值
+ */
+template<typename ...Args>
+inline void UTraceIgnore(const Args& ...) {
+}
+
+#ifdef _UTHREADPOOL_TRACE_ENABLE_
+    #define UTHREADPOOL_TRACE(name, ...)    STAP_PROBEV(uthreadpool, name, __VA_ARGS__)
+#else
+    #define UTHREADPOOL_TRACE(name, ...)    do { if (false) { UTraceIgnore(__VA_ARGS__); } } while (0)
+#endif
+
+/**
+ * 获取元素在探针中的id。提供 getTraceId() 的类型（如UTask）使用其返回值，其他类型为空
+ * @tparam T
+ * @param value
+ * @return
+ */
+template<typename T>
+auto UTraceId(const T& value, int) -> decltype(value.getTraceId()) {
+    return value.getTraceId();
+}
+
+template<typename T>
+const void* UTraceId(const T&, long) {
+    return nullptr;
+}
+
+#define UTHREADPOOL_TRACE_ID(value)    UTraceId(value, 0)
+
+#endif //UTRACE_H